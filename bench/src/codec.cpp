@@ -0,0 +1,155 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lib/sysexconf/common.h"
+#include "lib/sysexconf/codec.h"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+
+using namespace lib::sysexconf;
+
+namespace
+{
+    // per-value conversion with branches as it was done before batch kernels were introduced
+    void encodeLegacy(const uint16_t* values, uint8_t* output, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint8_t newHigh = (values[i] >> 8) & 0xFF;
+            uint8_t newLow  = values[i] & 0xFF;
+            newHigh         = (newHigh << 1) & 0x7F;
+
+            if ((newLow >> 7) & 0x01)
+            {
+                newHigh |= 0x01;
+            }
+            else
+            {
+                newHigh &= ~0x01;
+            }
+
+            output[(i * 2)]     = newHigh;
+            output[(i * 2) + 1] = newLow & 0x7F;
+        }
+    }
+
+    void decodeLegacy(const uint8_t* input, uint16_t* values, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint8_t high = input[(i * 2)];
+            uint8_t low  = input[(i * 2) + 1];
+
+            if (high & 0x01)
+            {
+                low |= (1 << 7);
+            }
+            else
+            {
+                low &= ~(1 << 7);
+            }
+
+            high >>= 1;
+
+            uint16_t joined = high;
+            joined <<= 8;
+            joined |= low;
+
+            values[i] = joined;
+        }
+    }
+
+    std::vector<uint16_t> testValues(size_t count)
+    {
+        std::vector<uint16_t> values(count);
+        uint32_t              seed = 1;
+
+        for (auto& value : values)
+        {
+            seed  = (seed * 1103515245) + 12345;
+            value = (seed >> 16) & MAX_VALUE;
+        }
+
+        return values;
+    }
+
+    template<void (*ENCODE)(const uint16_t*, uint8_t*, size_t)>
+    void encode(benchmark::State& state)
+    {
+        size_t               count  = state.range(0);
+        auto                 values = testValues(count);
+        std::vector<uint8_t> output(count * BYTES_PER_VALUE);
+
+        for (auto _ : state)
+        {
+            ENCODE(&values[0], &output[0], count);
+            benchmark::DoNotOptimize(&output[0]);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetBytesProcessed(state.iterations() * count * BYTES_PER_VALUE);
+
+        if (ENCODE == encode14Bit)
+        {
+            state.SetLabel(codecImplementation());
+        }
+    }
+
+    template<void (*DECODE)(const uint8_t*, uint16_t*, size_t)>
+    void decode(benchmark::State& state)
+    {
+        size_t               count  = state.range(0);
+        auto                 values = testValues(count);
+        std::vector<uint8_t> input(count * BYTES_PER_VALUE);
+
+        encode14BitScalar(&values[0], &input[0], count);
+
+        for (auto _ : state)
+        {
+            DECODE(&input[0], &values[0], count);
+            benchmark::DoNotOptimize(&values[0]);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * count);
+        state.SetBytesProcessed(state.iterations() * count * BYTES_PER_VALUE);
+
+        if (DECODE == decode14Bit)
+        {
+            state.SetLabel(codecImplementation());
+        }
+    }
+
+    // single message part, largest negotiable part, and bulk decoding of backups
+    void sizes(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->Arg(PARAMS_PER_MESSAGE)->Arg(256)->Arg(1 << 20);
+    }
+}    // namespace
+
+BENCHMARK(encode<encodeLegacy>)->Name("Encode14Bit/legacy")->Apply(sizes);
+BENCHMARK(encode<encode14BitScalar>)->Name("Encode14Bit/scalar")->Apply(sizes);
+BENCHMARK(encode<encode14Bit>)->Name("Encode14Bit/batch")->Apply(sizes);
+BENCHMARK(decode<decodeLegacy>)->Name("Decode14Bit/legacy")->Apply(sizes);
+BENCHMARK(decode<decode14BitScalar>)->Name("Decode14Bit/scalar")->Apply(sizes);
+BENCHMARK(decode<decode14Bit>)->Name("Decode14Bit/batch")->Apply(sizes);
@@ -0,0 +1,366 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lib/sysexconf/sysexconf.h"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <vector>
+
+using namespace lib::sysexconf;
+
+namespace
+{
+    constexpr uint8_t CUSTOM_REQUEST_ID = 54;
+    constexpr uint8_t SET_VALUE         = 0x3F;
+
+    const ManufacturerId M_ID = {
+        0x00,
+        0x53,
+        0x43
+    };
+
+    ///
+    /// \brief Layouts used in benchmarks, from the one used in tests up to far above real device sizes.
+    ///
+    enum class layout_t : uint8_t
+    {
+        SMALL,
+        OPENDECK,
+        LARGE,
+        AMOUNT
+    };
+
+    const char* const LAYOUT_NAME[static_cast<uint8_t>(layout_t::AMOUNT)] = {
+        "small",
+        "opendeck",
+        "large",
+    };
+
+    // number of parameters in each section of each block
+    const std::vector<std::vector<uint16_t>> LAYOUT_SMALL = {
+        { 10, 6, 33 },
+    };
+
+    // global, buttons, encoders, analog, leds, i2c and touchscreen blocks as found on OpenDeck boards
+    const std::vector<std::vector<uint16_t>> LAYOUT_OPENDECK = {
+        { 6, 3, 3, 128 },
+        { 64, 64, 64, 64, 64, 64 },
+        { 32, 32, 32, 32, 32, 32, 32, 32, 32 },
+        { 64, 64, 64, 64, 64, 64, 64, 64 },
+        { 64, 64, 64, 64, 64, 64, 6 },
+        { 4 },
+        { 64, 64, 64, 64, 64, 64, 64, 64, 64 },
+    };
+
+    // 16 x 16 sections, each needing 64 message parts
+    const std::vector<std::vector<uint16_t>> LAYOUT_LARGE(16, std::vector<uint16_t>(16, 64 * PARAMS_PER_MESSAGE));
+
+    class BenchDataHandler : public DataHandler
+    {
+        public:
+        BenchDataHandler() = default;
+
+        uint8_t get(uint8_t block, uint8_t section, uint16_t index, uint16_t& value) override
+        {
+            value = (block + section + index) & MAX_VALUE;
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t set(uint8_t block, uint8_t section, uint16_t index, uint16_t newValue) override
+        {
+            benchmark::DoNotOptimize(newValue);
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t customRequest(uint16_t request, CustomResponse& customResponse) override
+        {
+            customResponse.append(request);
+            customResponse.append(SET_VALUE);
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        void sendResponse(uint8_t* array, uint16_t size) override
+        {
+            benchmark::DoNotOptimize(array);
+            responses++;
+            responseBytes += size;
+        }
+
+        uint64_t responses     = 0;
+        uint64_t responseBytes = 0;
+    };
+
+    ///
+    /// \brief Protocol instance with one of the benchmark layouts applied and connection opened.
+    ///
+    class Device
+    {
+        public:
+        Device(layout_t layout)
+            : _sysEx(dataHandler, M_ID)
+        {
+            const std::vector<std::vector<uint16_t>>* parameters = &LAYOUT_SMALL;
+
+            switch (layout)
+            {
+            case layout_t::OPENDECK:
+                parameters = &LAYOUT_OPENDECK;
+                break;
+
+            case layout_t::LARGE:
+                parameters = &LAYOUT_LARGE;
+                break;
+
+            default:
+                break;
+            }
+
+            // blocks keep references to section lists so reserve upfront
+            _sections.reserve(parameters->size());
+
+            for (const auto& block : *parameters)
+            {
+                auto& sections = _sections.emplace_back();
+
+                for (auto count : block)
+                {
+                    // all sections accept full value range so that range checks are exercised too
+                    sections.emplace_back(count, 0, MAX_VALUE - 1);
+
+                    if (count > largestSectionParameters)
+                    {
+                        largestSectionParameters = count;
+                        largestBlock             = _layout.size();
+                        largestSection           = sections.size() - 1;
+                    }
+                }
+
+                _layout.emplace_back(sections);
+            }
+
+            _sysEx.setLayout(_layout);
+            _sysEx.setupCustomRequests(_customRequests);
+
+            handleMessage(specialRequest(specialRequest_t::CONN_OPEN));
+            dataHandler.responses     = 0;
+            dataHandler.responseBytes = 0;
+        }
+
+        void handleMessage(const std::vector<uint8_t>& request)
+        {
+            _sysEx.handleMessage(&request[0], request.size());
+        }
+
+        static std::vector<uint8_t> specialRequest(uint8_t wish)
+        {
+            return {
+                0xF0,
+                M_ID.id1,
+                M_ID.id2,
+                M_ID.id3,
+                static_cast<uint8_t>(status_t::REQUEST),
+                0,
+                wish,
+                0xF7
+            };
+        }
+
+        static std::vector<uint8_t> specialRequest(specialRequest_t request)
+        {
+            return specialRequest(static_cast<uint8_t>(request));
+        }
+
+        std::vector<uint8_t> standardRequest(wish_t wish, amount_t amount, uint8_t part) const
+        {
+            std::vector<uint8_t> request = {
+                0xF0,
+                M_ID.id1,
+                M_ID.id2,
+                M_ID.id3,
+                static_cast<uint8_t>(status_t::REQUEST),
+                part,
+                static_cast<uint8_t>(wish),
+                static_cast<uint8_t>(amount),
+                largestBlock,
+                largestSection,
+            };
+
+            if ((wish == wish_t::SET) && (amount == amount_t::ALL))
+            {
+                std::vector<uint8_t> values(PARAMS_PER_MESSAGE * BYTES_PER_VALUE);
+
+                for (size_t i = 0; i < PARAMS_PER_MESSAGE; i++)
+                {
+                    uint16_t value = SET_VALUE + i;
+                    encode14Bit(&value, &values[i * BYTES_PER_VALUE], 1);
+                }
+
+                request.insert(request.end(), values.begin(), values.end());
+            }
+            else
+            {
+                // index in the middle of the section and new value
+                uint16_t indexValue[2] = { static_cast<uint16_t>(largestSectionParameters / 2), SET_VALUE };
+                uint8_t  encoded[sizeof(indexValue)];
+
+                encode14Bit(indexValue, encoded, 2);
+                request.insert(request.end(), encoded, encoded + sizeof(encoded));
+            }
+
+            request.push_back(0xF7);
+
+            return request;
+        }
+
+        BenchDataHandler dataHandler;
+        uint16_t         largestSectionParameters = 0;
+        uint8_t          largestBlock             = 0;
+        uint8_t          largestSection           = 0;
+
+        private:
+        SysExConf                         _sysEx;
+        std::vector<std::vector<Section>> _sections;
+        std::vector<Block>                _layout;
+        std::vector<CustomRequest>        _customRequests = {
+            {
+                .requestId     = CUSTOM_REQUEST_ID,
+                .connOpenCheck = true,
+            },
+        };
+    };
+
+    ///
+    /// \brief Feeds the same request repeatedly and reports throughput.
+    /// @param [in] state       Benchmark state. First argument selects the layout.
+    /// @param [in] device      Device handling the request.
+    /// @param [in] request     Request to handle.
+    /// @param [in] parameters  Number of parameters transferred by single request.
+    ///
+    void run(benchmark::State& state, Device& device, const std::vector<uint8_t>& request, size_t parameters)
+    {
+        for (auto _ : state)
+        {
+            device.handleMessage(request);
+        }
+
+        auto iterations = static_cast<double>(state.iterations());
+        auto frames     = iterations + device.dataHandler.responses;
+        auto bytes      = (iterations * request.size()) + device.dataHandler.responseBytes;
+
+        // requests and responses in both directions
+        state.counters["frames/s"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+        state.counters["bytes/s"]  = benchmark::Counter(bytes, benchmark::Counter::kIsRate);
+
+        if (parameters)
+        {
+            // inverted rate yields time per parameter, printed with SI prefix (ns)
+            state.counters["time/param"] = benchmark::Counter(iterations * parameters, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+        }
+
+        state.SetLabel(LAYOUT_NAME[state.range(0)]);
+    }
+
+    void getSingle(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        run(state, device, device.standardRequest(wish_t::GET, amount_t::SINGLE, 0), 1);
+    }
+
+    void setSingle(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        run(state, device, device.standardRequest(wish_t::SET, amount_t::SINGLE, 0), 1);
+    }
+
+    void getAll(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        run(state, device, device.standardRequest(wish_t::GET, amount_t::ALL, 0), std::min<size_t>(PARAMS_PER_MESSAGE, device.largestSectionParameters));
+    }
+
+    void setAll(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+
+        // only the first part is sent, all layouts have sections spanning more than one part
+        run(state, device, device.standardRequest(wish_t::SET, amount_t::ALL, 0), PARAMS_PER_MESSAGE);
+    }
+
+    template<uint8_t PART>
+    void backup(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        run(state, device, device.standardRequest(wish_t::BACKUP, amount_t::ALL, PART), device.largestSectionParameters);
+    }
+
+    void special(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        run(state, device, Device::specialRequest(specialRequest_t::PARAMS_PER_MESSAGE), 0);
+    }
+
+    void custom(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        run(state, device, Device::specialRequest(CUSTOM_REQUEST_ID), 0);
+    }
+
+    void rejectedForeign(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        auto   request = device.standardRequest(wish_t::SET, amount_t::ALL, 0);
+
+        // frame for another device on the same bus
+        request.at(static_cast<uint8_t>(byteOrder_t::ID_BYTE_3))++;
+
+        run(state, device, request, 0);
+    }
+
+    void rejectedSection(benchmark::State& state)
+    {
+        Device device(static_cast<layout_t>(state.range(0)));
+        auto   request = device.standardRequest(wish_t::GET, amount_t::SINGLE, 0);
+
+        request.at(static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)) = MAX_SECTIONS - 1;
+
+        run(state, device, request, 0);
+    }
+
+    void layouts(benchmark::internal::Benchmark* benchmark)
+    {
+        for (int i = 0; i < static_cast<int>(layout_t::AMOUNT); i++)
+        {
+            benchmark->Arg(i);
+        }
+    }
+}    // namespace
+
+BENCHMARK(getSingle)->Name("HandleMessage/GetSingle")->Apply(layouts);
+BENCHMARK(setSingle)->Name("HandleMessage/SetSingle")->Apply(layouts);
+BENCHMARK(getAll)->Name("HandleMessage/GetAll")->Apply(layouts);
+BENCHMARK(setAll)->Name("HandleMessage/SetAll")->Apply(layouts);
+BENCHMARK(backup<127>)->Name("HandleMessage/Backup127")->Apply(layouts);
+BENCHMARK(backup<126>)->Name("HandleMessage/Backup126")->Apply(layouts);
+BENCHMARK(special)->Name("HandleMessage/Special")->Apply(layouts);
+BENCHMARK(custom)->Name("HandleMessage/Custom")->Apply(layouts);
+BENCHMARK(rejectedForeign)->Name("HandleMessage/RejectedForeign")->Apply(layouts);
+BENCHMARK(rejectedSection)->Name("HandleMessage/RejectedSection")->Apply(layouts);
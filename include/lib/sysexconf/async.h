@@ -0,0 +1,855 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "sysexconf.h"
+
+// coroutines need C++20, the rest of the library doesn't
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <utility>
+
+///
+/// \brief Variant of the protocol for storage which completes reads and writes asynchronously.
+/// @{
+///
+
+namespace lib::sysexconf
+{
+    ///
+    /// \brief Storage of the value returned by task.
+    /// @tparam T   Type of the value, void if task doesn't return anything.
+    ///
+    template<typename T>
+    class TaskValue
+    {
+        public:
+        void return_value(T value)
+        {
+            _value = std::move(value);
+        }
+
+        T take()
+        {
+            return std::move(_value);
+        }
+
+        private:
+        T _value = {};
+    };
+
+    template<>
+    class TaskValue<void>
+    {
+        public:
+        void return_void()
+        {}
+
+        void take()
+        {}
+    };
+
+    ///
+    /// \brief Lazily started coroutine.
+    /// Task is started either by awaiting it from another coroutine, which is then resumed once
+    /// the task completes, or by calling start, after which completion can be checked with done.
+    /// @tparam T   Type of the value returned by the task.
+    ///
+    template<typename T = void>
+    class Task
+    {
+        public:
+        class promise_type : public TaskValue<T>
+        {
+            public:
+            Task get_return_object()
+            {
+                return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            auto final_suspend() noexcept
+            {
+                struct Resume
+                {
+                    bool await_ready() noexcept
+                    {
+                        return false;
+                    }
+
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                    {
+                        auto continuation = handle.promise()._continuation;
+                        return continuation ? continuation : std::noop_coroutine();
+                    }
+
+                    void await_resume() noexcept
+                    {}
+                };
+
+                return Resume{};
+            }
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+
+            private:
+            friend class Task;
+
+            std::coroutine_handle<> _continuation = nullptr;
+        };
+
+        Task(Task&& other) noexcept
+            : _handle(std::exchange(other._handle, nullptr))
+            , _started(other._started)
+        {}
+
+        Task(const Task&)            = delete;
+        Task& operator=(const Task&) = delete;
+        Task& operator=(Task&&)      = delete;
+
+        ~Task()
+        {
+            if (_handle)
+            {
+                _handle.destroy();
+            }
+        }
+
+        ///
+        /// \brief Runs the task until it completes or waits for something.
+        /// Has no effect if the task has already been started.
+        ///
+        void start()
+        {
+            if (_handle && !_started)
+            {
+                _started = true;
+                _handle.resume();
+            }
+        }
+
+        ///
+        /// \brief Checks whether the task has completed.
+        /// \returns True if completed, false otherwise.
+        ///
+        bool done() const
+        {
+            return _handle && _handle.done();
+        }
+
+        ///
+        /// \brief Retrieves the value returned by completed task.
+        ///
+        T result()
+        {
+            return _handle.promise().take();
+        }
+
+        bool await_ready() const noexcept
+        {
+            return done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            _started                        = true;
+            _handle.promise()._continuation = awaiting;
+
+            return _handle;
+        }
+
+        T await_resume()
+        {
+            return result();
+        }
+
+        private:
+        explicit Task(std::coroutine_handle<promise_type> handle)
+            : _handle(handle)
+        {}
+
+        std::coroutine_handle<promise_type> _handle  = nullptr;
+        bool                                _started = false;
+    };
+
+    ///
+    /// \brief Status of storage operation which is completed outside of the coroutine.
+    /// Typically completed by the storage driver once transfer is done. Awaiting coroutine
+    /// is resumed from complete, so it must be called from the context which runs the protocol,
+    /// and not from an interrupt.
+    ///
+    class AsyncResult
+    {
+        public:
+        AsyncResult() = default;
+
+        AsyncResult(const AsyncResult&)            = delete;
+        AsyncResult& operator=(const AsyncResult&) = delete;
+
+        void complete(uint8_t status)
+        {
+            _status = status;
+            _done   = true;
+
+            if (_awaiting)
+            {
+                std::exchange(_awaiting, nullptr).resume();
+            }
+        }
+
+        bool await_ready() const noexcept
+        {
+            return _done;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            _awaiting = awaiting;
+        }
+
+        uint8_t await_resume() const noexcept
+        {
+            return _status;
+        }
+
+        private:
+        std::coroutine_handle<> _awaiting = nullptr;
+        uint8_t                 _status   = static_cast<uint8_t>(status_t::ACK);
+        bool                    _done     = false;
+    };
+
+    ///
+    /// \brief Interface of the object performing asynchronous reading and writing of actual data.
+    /// Same as DataHandler, except that reads and writes return tasks completed once storage is done.
+    ///
+    class AsyncDataHandler
+    {
+        public:
+        virtual ~AsyncDataHandler() = default;
+
+        virtual Task<uint8_t> get(uint8_t block, uint8_t section, uint16_t index, uint16_t& value)         = 0;
+        virtual Task<uint8_t> set(uint8_t block, uint8_t section, uint16_t index, uint16_t newValue)       = 0;
+        virtual uint8_t       customRequest(uint16_t request, DataHandler::CustomResponse& customResponse) = 0;
+        virtual void          sendResponse(uint8_t* array, uint16_t size)                                  = 0;
+
+        ///
+        /// \brief Retrieves multiple consecutive values from single section.
+        /// Default implementation retrieves values one by one, see DataHandler::getRange.
+        ///
+        virtual Task<uint8_t> getRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, uint16_t* values)
+        {
+            for (uint16_t i = 0; i < count; i++)
+            {
+                auto result = co_await get(block, section, startIndex + i, values[i]);
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    co_return result;
+                }
+            }
+
+            co_return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        ///
+        /// \brief Stores multiple consecutive values in single section.
+        /// Default implementation stores values one by one, see DataHandler::setRange.
+        ///
+        virtual Task<uint8_t> setRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, const uint16_t* values)
+        {
+            for (uint16_t i = 0; i < count; i++)
+            {
+                auto result = co_await set(block, section, startIndex + i, values[i]);
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    co_return result;
+                }
+            }
+
+            co_return static_cast<uint8_t>(status_t::ACK);
+        }
+    };
+
+    ///
+    /// \brief Data handler through which the protocol reaches asynchronous storage.
+    /// Values are retrieved before the request is processed and writes are recorded
+    /// while it's processed, so that the protocol itself never waits for the storage.
+    ///
+    class AsyncBridge final : public DataHandler
+    {
+        public:
+        ///
+        /// \brief Write recorded while processing the request.
+        ///
+        struct Write
+        {
+            uint8_t               block   = 0;     ///< Block index.
+            uint8_t               section = 0;     ///< Section index.
+            uint16_t              index   = 0;     ///< Index of first parameter.
+            std::vector<uint16_t> values  = {};    ///< Values to store.
+        };
+
+        explicit AsyncBridge(AsyncDataHandler& dataHandler)
+            : _dataHandler(dataHandler)
+        {}
+
+        uint8_t get(uint8_t block, uint8_t section, uint16_t index, uint16_t& value) override
+        {
+            if (!_active || (block != _block) || (section != _section) || (index < _first) || (static_cast<size_t>(index - _first) >= _values.size()))
+            {
+                // value hasn't been retrieved before the request was processed
+                return static_cast<uint8_t>(status_t::ERROR_READ);
+            }
+
+            value = _values[index - _first];
+            return _results[index - _first];
+        }
+
+        uint8_t set(uint8_t block, uint8_t section, uint16_t index, uint16_t newValue) override
+        {
+            return setRange(block, section, index, 1, &newValue);
+        }
+
+        uint8_t getRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, uint16_t* values) override
+        {
+            for (uint16_t i = 0; i < count; i++)
+            {
+                auto result = get(block, section, startIndex + i, values[i]);
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    return result;
+                }
+            }
+
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t setRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, const uint16_t* values) override
+        {
+            if (!_active)
+            {
+                // writes outside of request handling can't be awaited
+                return static_cast<uint8_t>(status_t::ERROR_WRITE);
+            }
+
+            _writes.push_back({ block, section, startIndex, std::vector<uint16_t>(values, values + count) });
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t customRequest(uint16_t request, CustomResponse& customResponse) override
+        {
+            return _dataHandler.customRequest(request, customResponse);
+        }
+
+        void sendResponse(uint8_t* array, uint16_t size) override
+        {
+            if (_holdResponses)
+            {
+                _responses.emplace_back(array, array + size);
+                return;
+            }
+
+            _dataHandler.sendResponse(array, size);
+        }
+
+        private:
+        friend class SysExConfAsync;
+
+        AsyncDataHandler&                 _dataHandler;
+        bool                              _active        = false;
+        bool                              _holdResponses = false;
+        uint8_t                           _block         = 0;
+        uint8_t                           _section       = 0;
+        uint16_t                          _first         = 0;
+        std::vector<uint16_t>             _values        = {};
+        std::vector<uint8_t>              _results       = {};
+        std::vector<Write>                _writes        = {};
+        std::vector<std::vector<uint8_t>> _responses     = {};
+    };
+
+    ///
+    /// \brief Variant of the protocol which suspends while the storage is reading or writing.
+    /// The protocol itself never waits for the storage: values needed for get and backup requests
+    /// are retrieved before the request is processed, with single getRange call per message part,
+    /// and writes are passed to the storage once the request is processed. Requests for all parts
+    /// of the section are processed one part at a time, so that values of the next part are retrieved
+    /// only once the previous part has been sent. Values available in shadow value cache or deferred
+    /// by write-behind aren't retrieved. Responses are sent only once the writes made while processing
+    /// the request are completed, including the ones flushed on connection close. Other work can be
+    /// done in the meantime, for example processing of MIDI realtime messages during long backups.
+    /// Requests are processed one at a time in order in which they're received. Since storage can
+    /// only be reached while request is processed, fillCache, write-behind outside of connection
+    /// close, dumps and flow control windows aren't available. Only the default session is supported.
+    ///
+    class SysExConfAsync : public SysExConfDirect<AsyncBridge>
+    {
+        public:
+        SysExConfAsync(AsyncDataHandler&     dataHandler,
+                       const ManufacturerId& manufacturerId)
+            : SysExConfDirect<AsyncBridge>(_bridge, manufacturerId)    // only reference is stored during construction
+            , _dataHandler(dataHandler)
+            , _manufacturerId(manufacturerId)
+            , _bridge(dataHandler)
+        {}
+
+        ///
+        /// \brief Handles incoming SysEx message.
+        /// Message is copied, so it doesn't need to remain valid until the task completes.
+        /// Task destroyed before it completes gives up its turn.
+        /// @param [in] array   Array containing the message.
+        /// @param [in] size    Message size.
+        /// \returns Task completed once the response has been sent.
+        ///
+        Task<> handleMessage(const uint8_t* array, uint16_t size)
+        {
+            return process(std::vector<uint8_t>(array, array + size));
+        }
+
+        ///
+        /// \brief Checks whether the request is being processed or waits to be processed.
+        /// \returns True if busy, false otherwise.
+        ///
+        bool busy() const
+        {
+            return _busy;
+        }
+
+        // messages can only be handled asynchronously
+        void feedByte(uint8_t data)                             = delete;
+        void feed(const uint8_t* data, uint16_t size)           = delete;
+        void feedUsbMidiPacket(const uint8_t* packet)           = delete;
+        void feedUsbMidi(const uint8_t* packets, uint16_t size) = delete;
+
+        private:
+        ///
+        /// \brief Waits until all previously received requests are processed.
+        /// If the waiting task is destroyed, it's removed from the queue.
+        ///
+        class Turn
+        {
+            public:
+            explicit Turn(SysExConfAsync& engine)
+                : _engine(engine)
+            {}
+
+            Turn(const Turn&)            = delete;
+            Turn& operator=(const Turn&) = delete;
+
+            ~Turn()
+            {
+                if (_awaiting)
+                {
+                    auto& waiting = _engine._waiting;
+                    waiting.erase(std::remove(waiting.begin(), waiting.end(), _awaiting), waiting.end());
+                }
+            }
+
+            bool await_ready() noexcept
+            {
+                return !std::exchange(_engine._busy, true);
+            }
+
+            void await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                _awaiting = awaiting;
+                _engine._waiting.push_back(awaiting);
+            }
+
+            void await_resume() noexcept
+            {
+                _awaiting = nullptr;
+            }
+
+            private:
+            SysExConfAsync&         _engine;
+            std::coroutine_handle<> _awaiting = nullptr;
+        };
+
+        ///
+        /// \brief Hands the engine over to the next request once the current one is done,
+        /// or once its task is destroyed.
+        ///
+        class Release
+        {
+            public:
+            explicit Release(SysExConfAsync& engine)
+                : _engine(engine)
+            {}
+
+            Release(const Release&)            = delete;
+            Release& operator=(const Release&) = delete;
+
+            ~Release()
+            {
+                _engine.release();
+            }
+
+            private:
+            SysExConfAsync& _engine;
+        };
+
+        ///
+        /// \brief Object performing asynchronous reading and writing of actual data.
+        ///
+        AsyncDataHandler& _dataHandler;
+
+        ///
+        /// \brief Reference to structure containing manufacturer ID bytes.
+        ///
+        const ManufacturerId& _manufacturerId;
+
+        ///
+        /// \brief Data handler used by the protocol.
+        ///
+        AsyncBridge _bridge;
+
+        ///
+        /// \brief Flag indicating that the request is being processed.
+        ///
+        bool _busy = false;
+
+        ///
+        /// \brief Flag indicating that waiting requests are being resumed by release.
+        ///
+        bool _resuming = false;
+
+        ///
+        /// \brief Flag indicating that request resumed by release has completed without suspending.
+        ///
+        bool _resumeNext = false;
+
+        ///
+        /// \brief Requests waiting for the request being processed, oldest first.
+        ///
+        std::deque<std::coroutine_handle<>> _waiting = {};
+
+        ///
+        /// \brief Processes single request.
+        /// @param [in] request Request message.
+        ///
+        Task<> process(std::vector<uint8_t> request)
+        {
+            co_await Turn(*this);
+
+            Release release(*this);
+            uint8_t parts = allParts(request);
+
+            if (!parts)
+            {
+                co_await run(request);
+                co_return;
+            }
+
+            uint8_t lastPart = request[static_cast<uint8_t>(byteOrder_t::PART_BYTE)];
+
+            for (uint8_t part = 0; part < parts; part++)
+            {
+                request[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = part;
+
+                if (!co_await run(request))
+                {
+                    // protocol stops on first failed part as well
+                    co_return;
+                }
+            }
+
+            if (lastPart == 126)
+            {
+                // same message which the protocol sends after all parts
+                buildAllPartsAck();
+                sendResponse(_bridge, false);
+            }
+        }
+
+        ///
+        /// \brief Retrieves values for the request, processes it and sends the responses
+        /// once the values written while processing it are stored.
+        /// @param [in] request Request message.
+        /// \returns True if the request has been processed successfully, false otherwise.
+        ///
+        Task<bool> run(const std::vector<uint8_t>& request)
+        {
+            co_await retrieve(request);
+
+            _bridge._active        = true;
+            _bridge._holdResponses = true;
+
+            SysExConfDirect<AsyncBridge>::handleMessage(request.data(), request.size());
+
+            _bridge._active = false;
+
+            co_await store();
+
+            bool success = true;
+
+            for (auto& response : _bridge._responses)
+            {
+                uint8_t status = response[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)];
+
+                // backup responses are sent as requests
+                success = success && ((status == static_cast<uint8_t>(status_t::ACK)) || (status == static_cast<uint8_t>(status_t::REQUEST)));
+                _dataHandler.sendResponse(response.data(), response.size());
+            }
+
+            _bridge._holdResponses = false;
+            _bridge._values.clear();
+            _bridge._results.clear();
+            _bridge._responses.clear();
+
+            co_return success;
+        }
+
+        ///
+        /// \brief Passes the engine to the next waiting request, or marks it as free.
+        /// Requests which complete without suspending are resumed one after another from
+        /// the outermost call, so that the stack doesn't grow with the number of waiting requests.
+        ///
+        void release()
+        {
+            _bridge._active        = false;
+            _bridge._holdResponses = false;
+            _bridge._values.clear();
+            _bridge._results.clear();
+            _bridge._writes.clear();
+            _bridge._responses.clear();
+
+            if (_waiting.empty())
+            {
+                _busy = false;
+                return;
+            }
+
+            if (_resuming)
+            {
+                // next request is resumed once this one returns to release below
+                _resumeNext = true;
+                return;
+            }
+
+            _resuming = true;
+
+            do
+            {
+                // next request takes over without releasing the engine
+                auto next = _waiting.front();
+
+                _resumeNext = false;
+                _waiting.pop_front();
+                next.resume();
+            } while (_resumeNext);
+
+            _resuming = false;
+        }
+
+        ///
+        /// \brief Checks whether the request is a get or backup request for all parts of the section
+        /// which is going to be accepted by the protocol.
+        /// @param [in] request Request message.
+        /// \returns Number of parts in the section, or 0 if the request should be processed as is.
+        ///
+        uint8_t allParts(const std::vector<uint8_t>& request)
+        {
+            if (!standardRequest(request) || (request.size() != STD_REQ_MIN_MSG_SIZE))
+            {
+                return 0;
+            }
+
+            auto    wish    = static_cast<wish_t>(request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
+            auto    amount  = static_cast<amount_t>(request[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)]);
+            uint8_t block   = request[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)];
+            uint8_t section = request[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)];
+            uint8_t part    = request[static_cast<uint8_t>(byteOrder_t::PART_BYTE)];
+
+            if (((wish != wish_t::GET) && (wish != wish_t::BACKUP)) || (amount != amount_t::ALL) || ((part != 126) && (part != 127)) ||
+                (block >= blocks()) || (section >= sections(block)))
+            {
+                return 0;
+            }
+
+            return (parameters(block, section) + paramsPerMessage() - 1) / paramsPerMessage();
+        }
+
+        ///
+        /// \brief Checks whether the request is a standard request meant for this device
+        /// while the connection is open.
+        /// @param [in] request Request message.
+        /// \returns True if standard request, false otherwise.
+        ///
+        bool standardRequest(const std::vector<uint8_t>& request)
+        {
+            return (request.size() >= STD_REQ_MIN_MSG_SIZE) &&
+                   (request[static_cast<uint8_t>(byteOrder_t::ID_BYTE_1)] == _manufacturerId.id1) &&
+                   (request[static_cast<uint8_t>(byteOrder_t::ID_BYTE_2)] == _manufacturerId.id2) &&
+                   (request[static_cast<uint8_t>(byteOrder_t::ID_BYTE_3)] == _manufacturerId.id3) &&
+                   (request[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] == static_cast<uint8_t>(status_t::REQUEST)) &&
+                   isConfigurationEnabled();
+        }
+
+        ///
+        /// \brief Checks whether the value can be served by the protocol without the storage.
+        /// @param [in] block   Block index.
+        /// @param [in] section Section index.
+        /// @param [in] index   Parameter index.
+        /// @param [in] single  Set to true if the value is retrieved on its own, and not as a part of range.
+        /// \returns True if value is cached or, for values retrieved on their own, deferred, false otherwise.
+        ///
+        bool available(uint8_t block, uint8_t section, uint16_t index, bool single)
+        {
+            [[maybe_unused]] auto lock     = lockState();
+            uint32_t              position = SysExConf::section(block, section).offset + index;
+
+            // ranges are served from cache only if all of their values are cached
+            return (_cacheEnabled && isCached(position)) || (single && _writeBehindEnabled && isPending(position));
+        }
+
+        ///
+        /// \brief Retrieves values which are going to be needed to process get or backup request.
+        /// Requests which are going to be rejected by the protocol don't retrieve anything.
+        /// @param [in] request Request message.
+        ///
+        Task<> retrieve(const std::vector<uint8_t>& request)
+        {
+            if (!standardRequest(request))
+            {
+                co_return;
+            }
+
+            auto    wish    = static_cast<wish_t>(request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
+            auto    amount  = static_cast<amount_t>(request[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)]);
+            uint8_t block   = request[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)];
+            uint8_t section = request[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)];
+            uint8_t part    = request[static_cast<uint8_t>(byteOrder_t::PART_BYTE)];
+
+            if (((wish != wish_t::GET) && (wish != wish_t::BACKUP)) || (block >= blocks()) || (section >= sections(block)))
+            {
+                co_return;
+            }
+
+            uint16_t numberOfParameters = parameters(block, section);
+            uint16_t first              = 0;
+            uint16_t count              = numberOfParameters;
+
+            if (amount == amount_t::SINGLE)
+            {
+                auto index = Merge14Bit(request[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)], request[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 1]);
+
+                first = index.value();
+                count = 1;
+            }
+            else if ((amount == amount_t::ALL) && (part != 126) && (part != 127))
+            {
+                first = part * paramsPerMessage();
+                count = (first < numberOfParameters) ? std::min<uint16_t>(paramsPerMessage(), numberOfParameters - first) : 0;
+            }
+
+            if (!count || (first >= numberOfParameters))
+            {
+                co_return;
+            }
+
+            // changed parameters aren't known outside of the protocol, whole section is retrieved for them
+            // values are retrieved one by one in that case as well
+            bool single = amount != amount_t::ALL;
+
+            _bridge._block   = block;
+            _bridge._section = section;
+            _bridge._first   = first;
+            _bridge._values.assign(count, 0);
+            _bridge._results.assign(count, static_cast<uint8_t>(status_t::ACK));
+
+            for (uint16_t i = 0; i < count; i += paramsPerMessage())
+            {
+                uint16_t size   = std::min<uint16_t>(paramsPerMessage(), count - i);
+                bool     needed = false;
+
+                for (uint16_t j = 0; !needed && (j < size); j++)
+                {
+                    needed = !available(block, section, first + i + j, single);
+                }
+
+                if (!needed)
+                {
+                    continue;
+                }
+
+                uint8_t result = (size == 1) ? co_await _dataHandler.get(block, section, first + i, _bridge._values[i])
+                                             : co_await _dataHandler.getRange(block, section, first + i, size, &_bridge._values[i]);
+
+                std::fill(&_bridge._results[i], &_bridge._results[i] + size, result);
+            }
+        }
+
+        ///
+        /// \brief Stores values written while processing the request.
+        /// If any write fails, held responses report the failure instead of status_t::ACK,
+        /// unless user error ignore mode is enabled.
+        ///
+        Task<> store()
+        {
+            uint8_t status = static_cast<uint8_t>(status_t::ACK);
+
+            for (auto& write : _bridge._writes)
+            {
+                uint8_t result = (write.values.size() == 1) ? co_await _dataHandler.set(write.block, write.section, write.index, write.values[0])
+                                                            : co_await _dataHandler.setRange(write.block, write.section, write.index, write.values.size(), write.values.data());
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    // values have been cached as stored
+                    invalidateCache(write.block, write.section);
+
+                    if (status == static_cast<uint8_t>(status_t::ACK))
+                    {
+                        status = result;
+                    }
+                }
+            }
+
+            _bridge._writes.clear();
+
+            if ((status != static_cast<uint8_t>(status_t::ACK)) && !isUserErrorIgnoreModeEnabled())
+            {
+                for (auto& response : _bridge._responses)
+                {
+                    response[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = status;
+                }
+            }
+        }
+    };
+}    // namespace lib::sysexconf
+
+/// @}
+
+#endif
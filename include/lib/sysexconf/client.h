@@ -0,0 +1,157 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "common.h"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+///
+/// \brief Host side of the configuration protocol.
+/// @{
+///
+
+namespace lib::sysexconf
+{
+    ///
+    /// \brief Result of single request sent by the client.
+    ///
+    struct ClientResult
+    {
+        status_t              status = status_t::ACK;    ///< Status reported by the device.
+        std::vector<uint16_t> values = {};                 ///< Values carried by all response frames, in the order they were received.
+    };
+
+    using clientCompletion_t = std::function<void(const ClientResult& result)>;
+
+    ///
+    /// \brief Builds requests, matches responses to them and keeps several requests in flight.
+    /// Device answers requests received on single port in order, so responses are matched to the
+    /// oldest request in flight. Requests for all parts use part 126 so that each of them is
+    /// completed by the final ACK frame without the client having to know the layout.
+    /// Requests which change the session (opening and closing of connection, number of parameters
+    /// per message and compression) are completed before any following request is sent, so that
+    /// requests are always built and responses decoded with the settings used by the device.
+    ///
+    class SysExConfClient
+    {
+        public:
+        ///
+        /// \brief Interface used to send requests to the device.
+        /// Responses are passed back to the client with handleMessage.
+        ///
+        class Transport
+        {
+            public:
+            virtual ~Transport() = default;
+
+            virtual bool send(const uint8_t* array, uint16_t size) = 0;
+        };
+
+        SysExConfClient(Transport&            transport,
+                        const ManufacturerId& manufacturerId)
+            : _transport(transport)
+            , _manufacturerId(manufacturerId)
+        {}
+
+        void          reset();
+        void          setPipelineDepth(uint8_t depth);
+        bool          handleMessage(const uint8_t* array, uint16_t size);
+        bool          get(uint8_t block, uint8_t section, uint16_t index, clientCompletion_t completion);
+        bool          set(uint8_t block, uint8_t section, uint16_t index, uint16_t value, clientCompletion_t completion);
+        bool          getAll(uint8_t block, uint8_t section, clientCompletion_t completion);
+        bool          getChanged(uint8_t block, uint8_t section, clientCompletion_t completion);
+        bool          backup(uint8_t block, uint8_t section, clientCompletion_t completion);
+        bool          setAll(uint8_t block, uint8_t section, const std::vector<uint16_t>& values, clientCompletion_t completion);
+        bool          request(wish_t wish, amount_t amount, uint8_t block, uint8_t section, uint8_t part, uint16_t index, uint16_t value, clientCompletion_t completion);
+        bool          special(specialRequest_t request, clientCompletion_t completion);
+        bool          special(specialRequest_t request, uint16_t value, clientCompletion_t completion);
+        bool          custom(uint8_t requestId, clientCompletion_t completion);
+        size_t        inFlight() const;
+        size_t        queued() const;
+        uint16_t      paramsPerMessage() const;
+        compression_t compression() const;
+
+        private:
+        ///
+        /// \brief Request which has been sent or is waiting to be sent.
+        ///
+        struct Pending
+        {
+            std::vector<uint8_t>  frame      = {};         ///< Request frame, without values for SET ALL request.
+            std::vector<uint16_t> values     = {};         ///< Values of SET ALL request, split into parts once the request is about to be sent.
+            bool                  allParts   = false;      ///< Flag indicating that request is completed by final ACK frame.
+            bool                  barrier    = false;      ///< Flag indicating that request changes the session, nothing is sent until it's completed.
+            ClientResult          result     = {};         ///< Result accumulated from response frames.
+            clientCompletion_t    completion = nullptr;    ///< Function called once the request is completed.
+        };
+
+        ///
+        /// \brief Object used to send requests.
+        ///
+        Transport& _transport;
+
+        ///
+        /// \brief Reference to structure containing manufacturer ID bytes.
+        ///
+        const ManufacturerId& _manufacturerId;
+
+        ///
+        /// \brief Maximum number of requests sent without waiting for their responses.
+        ///
+        uint8_t _pipelineDepth = 1;
+
+        ///
+        /// \brief Requests sent to the device, oldest first.
+        ///
+        std::deque<Pending> _inFlight = {};
+
+        ///
+        /// \brief Requests waiting for room in the pipeline.
+        ///
+        std::deque<Pending> _queue = {};
+
+        ///
+        /// \brief Number of parameters per message negotiated with the device.
+        ///
+        uint16_t _paramsPerMessage = PARAMS_PER_MESSAGE;
+
+        ///
+        /// \brief Encoding of values for all parameters negotiated with the device.
+        ///
+        compression_t _compression = compression_t::NONE;
+
+        std::vector<uint8_t> header(uint8_t part, uint8_t wish) const;
+        std::vector<uint8_t> standard(wish_t wish, amount_t amount, uint8_t block, uint8_t section, uint8_t part) const;
+        bool                 enqueue(Pending&& pending);
+        void                 sendQueued();
+        void                 splitSetAll();
+        bool                 barrierInFlight() const;
+        bool                 matches(const Pending& pending, const uint8_t* array, uint16_t size) const;
+        bool                 appendValues(Pending& pending, const uint8_t* array, uint16_t size) const;
+        void                 negotiated(const std::vector<uint8_t>& frame);
+    };
+}    // namespace lib::sysexconf
+
+/// @}
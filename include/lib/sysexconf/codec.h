@@ -0,0 +1,126 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+///
+/// \brief Batch conversion between 14-bit values and SysEx byte pairs.
+/// Byte pairs use the same layout as Split14Bit/Merge14Bit: high 7 bits first,
+/// low 7 bits second. Vectorized implementation is selected at compile time
+/// (AVX2, SSE2 or NEON), with branch-free scalar code used everywhere else.
+/// @{
+///
+
+namespace lib::sysexconf
+{
+    ///
+    /// \brief Encodes array of 14-bit values into SysEx byte pairs.
+    /// @param [in] values      Array with values to encode.
+    /// @param [out] output     Array in which encoded bytes are stored (2 * count bytes).
+    /// @param [in] count       Number of values to encode.
+    ///
+    void encode14Bit(const uint16_t* values, uint8_t* output, size_t count);
+
+    ///
+    /// \brief Decodes array of SysEx byte pairs into 14-bit values.
+    /// @param [in] input       Array with encoded bytes (2 * count bytes).
+    /// @param [out] values     Array in which decoded values are stored.
+    /// @param [in] count       Number of values to decode.
+    ///
+    void decode14Bit(const uint8_t* input, uint16_t* values, size_t count);
+
+    ///
+    /// \brief Scalar implementation of encode14Bit.
+    /// Always available, regardless of the instruction set the library is built for.
+    ///
+    void encode14BitScalar(const uint16_t* values, uint8_t* output, size_t count);
+
+    ///
+    /// \brief Scalar implementation of decode14Bit.
+    /// Always available, regardless of the instruction set the library is built for.
+    ///
+    void decode14BitScalar(const uint8_t* input, uint16_t* values, size_t count);
+
+    ///
+    /// \brief Retrieves name of the implementation used by encode14Bit and decode14Bit.
+    /// \returns Implementation name ("avx2", "sse2", "neon" or "scalar").
+    ///
+    const char* codecImplementation();
+}    // namespace lib::sysexconf
+
+/// @}
+
+///
+/// \brief Run-length coding of 14-bit values within 7-bit SysEx constraints.
+/// Values are coded in groups, each starting with control byte. Lower 6 bits of
+/// control byte hold the number of values in group minus one. If bit 6 is set,
+/// group is a run and single byte pair follows which is repeated for all values
+/// in group, otherwise group is literal and byte pair for each value follows.
+/// @{
+///
+
+namespace lib::sysexconf
+{
+    ///
+    /// \brief Maximum number of values in single group.
+    ///
+    constexpr uint8_t RLE_MAX_GROUP = 64;
+
+    ///
+    /// \brief Flag in control byte indicating a run.
+    ///
+    constexpr uint8_t RLE_RUN = 0x40;
+
+    ///
+    /// \brief Retrieves maximum size of coded values.
+    /// Literal groups are one byte larger than the values they hold, runs are always smaller.
+    /// @param [in] count   Number of values.
+    /// \returns Maximum size in bytes.
+    ///
+    constexpr size_t RLE_MAX_SIZE(size_t count)
+    {
+        return (count * 2) + ((count + RLE_MAX_GROUP - 1) / RLE_MAX_GROUP);
+    }
+
+    ///
+    /// \brief Codes array of 14-bit values.
+    /// @param [in] values      Array with values to code.
+    /// @param [out] output     Array in which coded bytes are stored (up to RLE_MAX_SIZE(count) bytes).
+    /// @param [in] count       Number of values to code.
+    /// \returns Number of coded bytes.
+    ///
+    size_t encodeRle(const uint16_t* values, uint8_t* output, size_t count);
+
+    ///
+    /// \brief Decodes array of run-length coded values.
+    /// @param [in] input       Array with coded bytes.
+    /// @param [in] size        Number of coded bytes.
+    /// @param [out] values     Array in which decoded values are stored.
+    /// @param [in] count       Expected number of values.
+    /// \returns True if coded bytes hold exactly the expected number of values, false otherwise.
+    ///
+    bool decodeRle(const uint8_t* input, size_t size, uint16_t* values, size_t count);
+}    // namespace lib::sysexconf
+
+/// @}
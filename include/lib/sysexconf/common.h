@@ -22,8 +22,14 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <inttypes.h>
 #include <stdlib.h>
+#include "codec.h"
+
+#ifndef SYS_EX_CONF_MAX_PARAMS_PER_MESSAGE
+#define SYS_EX_CONF_MAX_PARAMS_PER_MESSAGE 32
+#endif
 
 namespace lib::sysexconf
 {
@@ -45,7 +51,18 @@ namespace lib::sysexconf
     {
         SINGLE,
         ALL,
-        INVALID
+        INVALID,
+        CHANGED,    ///< Parameters changed since last checkpoint, sent as index/value pairs. Placed after INVALID so that 0x02 stays invalid.
+    };
+
+    ///
+    /// \brief Descriptive list of encodings of values in requests and responses for all parameters.
+    ///
+    enum class compression_t : uint8_t
+    {
+        NONE,    ///< Two bytes per value.
+        RLE,     ///< Run-length coded values, see encodeRle.
+        AMOUNT
     };
 
     ///
@@ -75,13 +92,27 @@ namespace lib::sysexconf
     ///
     enum class specialRequest_t : uint8_t
     {
-        CONN_CLOSE,            // 0x00
-        CONN_OPEN,             // 0x01
-        BYTES_PER_VALUE,       // 0x02
-        PARAMS_PER_MESSAGE,    // 0x03
+        CONN_CLOSE,                // 0x00
+        CONN_OPEN,                 // 0x01
+        BYTES_PER_VALUE,           // 0x02
+        PARAMS_PER_MESSAGE,        // 0x03
+        MAX_PARAMS_PER_MESSAGE,    // 0x04
+        CHECKPOINT,                // 0x05
+        COMPRESSION,               // 0x06
+        DUMP,                      // 0x07
+        WINDOW,                    // 0x08
+        WINDOW_ACK,                // 0x09
+        STATS,                     // 0x0A
         AMOUNT
     };
 
+    ///
+    /// \brief Lowest ID which can be used by custom requests.
+    /// Custom requests could use IDs from 0x04 before special requests MAX_PARAMS_PER_MESSAGE
+    /// to STATS took IDs 0x04 to 0x0A, so such requests need to be moved to this ID or above.
+    ///
+    constexpr uint8_t CUSTOM_REQUEST_ID_MIN = static_cast<uint8_t>(specialRequest_t::AMOUNT);
+
     ///
     /// \brief Descriptive list of bytes in SysEx message.
     ///
@@ -100,11 +131,53 @@ namespace lib::sysexconf
         INDEX_BYTE,      // 10
     };
 
-    constexpr uint16_t PARAMS_PER_MESSAGE   = 32;
-    constexpr uint16_t BYTES_PER_VALUE      = 2;
-    constexpr uint8_t  SPECIAL_REQ_MSG_SIZE = (static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1) + 1;    // extra byte for end
-    constexpr uint8_t  STD_REQ_MIN_MSG_SIZE = static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + (BYTES_PER_VALUE * 2) + 1;
-    constexpr uint16_t MAX_MESSAGE_SIZE     = STD_REQ_MIN_MSG_SIZE + (PARAMS_PER_MESSAGE * BYTES_PER_VALUE);
+    constexpr uint16_t PARAMS_PER_MESSAGE         = 32;
+    constexpr uint16_t MAX_PARAMS_PER_MESSAGE     = SYS_EX_CONF_MAX_PARAMS_PER_MESSAGE;
+    constexpr uint16_t BYTES_PER_VALUE            = 2;
+    constexpr uint8_t  SPECIAL_REQ_MSG_SIZE       = (static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1) + 1;    // extra byte for end
+    constexpr uint8_t  SPECIAL_REQ_VALUE_MSG_SIZE = SPECIAL_REQ_MSG_SIZE + BYTES_PER_VALUE;
+    constexpr uint8_t  STD_REQ_MIN_MSG_SIZE       = static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + (BYTES_PER_VALUE * 2) + 1;
+    constexpr uint16_t MAX_MESSAGE_SIZE           = STD_REQ_MIN_MSG_SIZE + RLE_MAX_SIZE(MAX_PARAMS_PER_MESSAGE);
+
+    // parts are computed for default number of parameters per message, session can only increase it
+    static_assert(MAX_PARAMS_PER_MESSAGE >= PARAMS_PER_MESSAGE, "Maximum number of parameters per message can't be smaller than default one");
+    static_assert(MAX_PARAMS_PER_MESSAGE <= 0x3FFF, "Maximum number of parameters per message must fit in single value");
+    static_assert(BYTES_PER_VALUE == 2, "Run-length coding assumes two bytes per value");
+
+    ///
+    /// \brief Limits of the layout which can be addressed by the protocol.
+    /// Block and section are transferred as single 7-bit byte each, while part
+    /// values 126 and 127 are reserved for requests which loop over all parts.
+    ///
+    constexpr uint16_t MAX_BLOCKS     = 128;
+    constexpr uint16_t MAX_SECTIONS   = 128;
+    constexpr uint8_t  MAX_PARTS      = 126;
+    constexpr uint16_t MAX_PARAMETERS = MAX_PARTS * PARAMS_PER_MESSAGE;
+    constexpr uint16_t MAX_VALUE      = 0x3FFF;
+
+    ///
+    /// \brief Maximum number of slots in response ring.
+    ///
+    constexpr uint8_t MAX_RESPONSE_SLOTS = 8;
+
+    ///
+    /// \brief Size of single USB MIDI event packet and maximum size of message
+    /// once it's packed into USB MIDI event packets (3 SysEx bytes per packet).
+    ///
+    constexpr uint8_t  USB_MIDI_PACKET_SIZE      = 4;
+    constexpr uint16_t USB_MIDI_MAX_MESSAGE_SIZE = ((MAX_MESSAGE_SIZE + 2) / 3) * USB_MIDI_PACKET_SIZE;
+
+    ///
+    /// \brief List of USB MIDI code index numbers used for SysEx transfer.
+    ///
+    enum class usbMidiCin_t : uint8_t
+    {
+        SYS_EX_START     = 0x04,    ///< SysEx starts or continues, 3 bytes.
+        SYS_EX_END_1BYTE = 0x05,    ///< SysEx ends with following single byte.
+        SYS_EX_END_2BYTE = 0x06,    ///< SysEx ends with following two bytes.
+        SYS_EX_END_3BYTE = 0x07,    ///< SysEx ends with following three bytes.
+        SINGLE_BYTE      = 0x0F,    ///< Single byte.
+    };
 
     ///
     /// \brief Structure holding SysEx manufacturer ID bytes.
@@ -117,12 +190,35 @@ namespace lib::sysexconf
     };
 
     ///
-    /// \brief Structure containing data for single custom request.
+    /// \brief Structure holding single write accepted by the protocol, but not yet stored by data handler.
     ///
-    struct CustomRequest
+    struct JournalEntry
+    {
+        uint8_t  block   = 0;    ///< Block index.
+        uint8_t  section = 0;    ///< Section index.
+        uint16_t index   = 0;    ///< Parameter index.
+        uint16_t value   = 0;    ///< New value.
+    };
+
+    ///
+    /// \brief Structure describing single segment of the response passed to DataHandler::sendResponseV.
+    ///
+    struct ResponseSegment
     {
-        uint16_t requestId     = 0;        ///< ID byte representing specific request.
-        bool     connOpenCheck = false;    ///< Flag indicating whether or not SysEx connection should be enabled before processing request.
+        const uint8_t* data = nullptr;    ///< Pointer to first byte of the segment.
+        uint16_t       size = 0;          ///< Segment size in bytes.
+    };
+
+    ///
+    /// \brief Descriptive list of segments passed to DataHandler::sendResponseV.
+    ///
+    enum class responseSegment_t : uint8_t
+    {
+        HEADER,     ///< Start byte, manufacturer ID and status.
+        PART,       ///< Message part.
+        REQUEST,    ///< Rest of the request echoed in response.
+        PAYLOAD,    ///< Values appended by the protocol, including the end byte.
+        AMOUNT
     };
 
     ///
@@ -140,10 +236,33 @@ namespace lib::sysexconf
         uint16_t newValue = 0;
     };
 
+    ///
+    /// \brief Structure holding precomputed data for single section.
+    ///
+    struct SectionDescriptor
+    {
+        uint32_t offset             = 0;        ///< Position of first parameter of the section among all parameters in layout.
+        uint16_t numberOfParameters = 0;        ///< Total number of parameters in section.
+        uint16_t newValueMin        = 0;        ///< Minimum allowed value for parameters in section.
+        uint16_t newValueMax        = 0;        ///< Maximum allowed value for parameters in section.
+        uint8_t  parts              = 0;        ///< Number of message parts needed to transfer all parameters with default number of parameters per message.
+        uint8_t  lastPartParameters = 0;        ///< Number of parameters in last message part with default number of parameters per message.
+        bool     noRangeCheck       = false;    ///< Flag indicating that new values aren't checked against min/max.
+    };
+
+    ///
+    /// \brief Structure holding precomputed data for single block.
+    ///
+    struct BlockDescriptor
+    {
+        uint16_t firstSection = 0;    ///< Position of first section of the block in section descriptor table.
+        uint8_t  sections     = 0;    ///< Number of sections in the block.
+    };
+
     class Section
     {
         public:
-        Section(
+        constexpr Section(
             uint16_t numberOfParameters,
             uint16_t newValueMin,
             uint16_t newValueMax)
@@ -160,31 +279,45 @@ namespace lib::sysexconf
             }
         }
 
-        uint16_t numberOfParameters() const
+        constexpr uint16_t numberOfParameters() const
         {
             return NUMBER_OF_PARAMETERS;
         }
 
-        uint16_t newValueMin() const
+        constexpr uint16_t newValueMin() const
         {
             return NEW_VALUE_MIN;
         }
 
-        uint16_t newValueMax() const
+        constexpr uint16_t newValueMax() const
         {
             return NEW_VALUE_MAX;
         }
 
-        uint8_t parts() const
+        constexpr uint16_t parts() const
         {
             return _parts;
         }
 
+        constexpr SectionDescriptor descriptor() const
+        {
+            SectionDescriptor descriptor;
+
+            descriptor.numberOfParameters = NUMBER_OF_PARAMETERS;
+            descriptor.newValueMin        = NEW_VALUE_MIN;
+            descriptor.newValueMax        = NEW_VALUE_MAX;
+            descriptor.parts              = static_cast<uint8_t>(_parts);
+            descriptor.lastPartParameters = _parts ? NUMBER_OF_PARAMETERS - ((_parts - 1) * PARAMS_PER_MESSAGE) : 0;
+            descriptor.noRangeCheck       = NEW_VALUE_MIN == NEW_VALUE_MAX;
+
+            return descriptor;
+        }
+
         private:
         const uint16_t NUMBER_OF_PARAMETERS;
         const uint16_t NEW_VALUE_MIN;
         const uint16_t NEW_VALUE_MAX;
-        uint8_t        _parts = 0;
+        uint16_t       _parts = 0;
     };
 
     ///
@@ -202,28 +335,87 @@ namespace lib::sysexconf
         std::vector<Section>& _sections;
     };
 
-    class Merge14Bit
+    ///
+    /// \brief Layout known at compile time.
+    /// Data for all sections is computed during compilation and stored in
+    /// constant tables, so no layout processing or allocation happens at runtime.
+    /// @tparam SECTIONS    Number of sections in each block.
+    ///
+    template<size_t... SECTIONS>
+    class StaticLayout
     {
         public:
-        Merge14Bit(uint8_t high, uint8_t low)
+        static constexpr size_t BLOCKS         = sizeof...(SECTIONS);
+        static constexpr size_t TOTAL_SECTIONS = (SECTIONS + ... + 0);
+
+        static_assert(TOTAL_SECTIONS > 0, "Layout must contain at least one section");
+
+        constexpr StaticLayout(const Section (&sections)[TOTAL_SECTIONS])
         {
-            if (high & 0x01)
+            const size_t SECTIONS_PER_BLOCK[BLOCKS] = { SECTIONS... };
+            size_t       firstSection               = 0;
+
+            for (size_t i = 0; i < BLOCKS; i++)
             {
-                low |= (1 << 7);
+                _blocks[i].firstSection = firstSection;
+                _blocks[i].sections     = SECTIONS_PER_BLOCK[i];
+                _valid                  = _valid && (SECTIONS_PER_BLOCK[i] <= MAX_SECTIONS);
+                firstSection += SECTIONS_PER_BLOCK[i];
             }
-            else
+
+            uint32_t offset = 0;
+
+            for (size_t i = 0; i < TOTAL_SECTIONS; i++)
             {
-                low &= ~(1 << 7);
+                _sections[i]        = sections[i].descriptor();
+                _sections[i].offset = offset;
+                offset += _sections[i].numberOfParameters;
+                _valid       = _valid && (sections[i].numberOfParameters() <= MAX_PARAMETERS) && (_sections[i].newValueMin <= MAX_VALUE) && (_sections[i].newValueMax <= MAX_VALUE);
             }
 
-            high >>= 1;
+            _valid = _valid && (BLOCKS <= MAX_BLOCKS);
+        }
 
-            uint16_t joined = 0;
-            joined          = high;
-            joined <<= 8;
-            joined |= low;
+        ///
+        /// \brief Checks whether the layout can be addressed by the protocol.
+        /// \returns True if valid, false otherwise.
+        ///
+        constexpr bool valid() const
+        {
+            return _valid;
+        }
 
-            _value = joined;
+        constexpr const SectionDescriptor* sections() const
+        {
+            return _sections.data();
+        }
+
+        constexpr const BlockDescriptor* blocks() const
+        {
+            return _blocks.data();
+        }
+
+        ///
+        /// \brief Retrieves total number of parameters in all sections of the layout.
+        ///
+        constexpr uint32_t parameters() const
+        {
+            return _sections[TOTAL_SECTIONS - 1].offset + _sections[TOTAL_SECTIONS - 1].numberOfParameters;
+        }
+
+        private:
+        std::array<SectionDescriptor, TOTAL_SECTIONS> _sections = {};
+        std::array<BlockDescriptor, BLOCKS>           _blocks   = {};
+        bool                                          _valid    = true;
+    };
+
+    class Merge14Bit
+    {
+        public:
+        Merge14Bit(uint8_t high, uint8_t low)
+        {
+            // branch-free: lowest bit of high byte becomes bit 7 of the value
+            _value = (static_cast<uint16_t>(high) << 7) | (low & 0x7F);
         }
 
         uint16_t value() const
@@ -244,22 +436,9 @@ namespace lib::sysexconf
         public:
         Split14Bit(uint16_t value)
         {
-            uint8_t newHigh = (value >> 8) & 0xFF;
-            uint8_t newLow  = value & 0xFF;
-            newHigh         = (newHigh << 1) & 0x7F;
-
-            if ((newLow >> 7) & 0x01)
-            {
-                newHigh |= 0x01;
-            }
-            else
-            {
-                newHigh &= ~0x01;
-            }
-
-            newLow &= 0x7F;
-            _high = newHigh;
-            _low  = newLow;
+            // branch-free: bit 7 of the value becomes lowest bit of high byte
+            _high = (value >> 7) & 0x7F;
+            _low  = value & 0x7F;
         }
 
         uint8_t high() const
@@ -314,5 +493,160 @@ namespace lib::sysexconf
         virtual uint8_t set(uint8_t block, uint8_t section, uint16_t index, uint16_t newValue) = 0;
         virtual uint8_t customRequest(uint16_t request, CustomResponse& customResponse)        = 0;
         virtual void    sendResponse(uint8_t* array, uint16_t size)                            = 0;
+
+        ///
+        /// \brief Used to retrieve multiple consecutive values from the same section.
+        /// Protocol uses this function instead of get for requests with all parameters,
+        /// so that storage backend can read entire message part in single transaction.
+        /// Default implementation retrieves values one by one using get.
+        /// @param [in] block       Block index.
+        /// @param [in] section     Section index.
+        /// @param [in] startIndex  Index of first parameter to retrieve.
+        /// @param [in] count       Number of parameters to retrieve.
+        /// @param [out] values     Array in which retrieved values are stored.
+        /// \returns status_t::ACK on success, error status otherwise.
+        ///
+        virtual uint8_t getRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, uint16_t* values)
+        {
+            for (uint16_t i = 0; i < count; i++)
+            {
+                uint8_t result = get(block, section, startIndex + i, values[i]);
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    return result;
+                }
+            }
+
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        ///
+        /// \brief Used to store multiple consecutive values in the same section.
+        /// Protocol uses this function instead of set for requests with all parameters.
+        /// All values are validated before this function is called.
+        /// Default implementation stores values one by one using set.
+        /// @param [in] block       Block index.
+        /// @param [in] section     Section index.
+        /// @param [in] startIndex  Index of first parameter to store.
+        /// @param [in] count       Number of parameters to store.
+        /// @param [in] values      Array with values to store.
+        /// \returns status_t::ACK on success, error status otherwise.
+        ///
+        virtual uint8_t setRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, const uint16_t* values)
+        {
+            for (uint16_t i = 0; i < count; i++)
+            {
+                uint8_t result = set(block, section, startIndex + i, values[i]);
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    return result;
+                }
+            }
+
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        ///
+        /// \brief Used to send response to request received in USB MIDI event packets.
+        /// Response is already packed into event packets which can be transferred
+        /// by USB endpoint as they are.
+        /// @param [in] packets     Array with USB MIDI event packets.
+        /// @param [in] size        Array size in bytes (always multiple of USB_MIDI_PACKET_SIZE).
+        /// \returns True if response has been sent. When false is returned, same
+        ///          response is sent via sendResponse as standard SysEx array.
+        ///
+        virtual bool sendUsbMidiResponse([[maybe_unused]] uint8_t* packets, [[maybe_unused]] uint16_t size)
+        {
+            return false;
+        }
+
+        ///
+        /// \brief Used to send response stored in response ring slot.
+        /// Called instead of sendResponse when response ring is configured.
+        /// Ownership of the slot is handed over to the transport, which doesn't
+        /// have to copy the response before returning. Once the response is
+        /// transmitted, transport must release the slot with SysExConf::releaseResponseSlot.
+        /// Responses must be transmitted in the order in which they're received,
+        /// including the ones passed to sendResponse.
+        /// Default implementation returns false, in which case slot is released
+        /// immediately and response is sent using sendResponse.
+        /// @param [in] slot    Index of the slot in which response is stored.
+        /// @param [in] array   Response array.
+        /// @param [in] size    Response size.
+        /// \returns True if transport has taken over the slot, false otherwise.
+        ///
+        virtual bool sendResponseSlot([[maybe_unused]] uint8_t slot, [[maybe_unused]] uint8_t* array, [[maybe_unused]] uint16_t size)
+        {
+            return false;
+        }
+
+        ///
+        /// \brief Called when next slot in response ring is still being transmitted.
+        /// Transport can block here until the slot is released (for instance, by polling
+        /// the DMA transfer). If the slot is still in use once this function returns,
+        /// response is built in internal buffer and sent using sendResponse.
+        /// @param [in] slot    Index of the slot which protocol is waiting for.
+        ///
+        virtual void waitResponseSlot([[maybe_unused]] uint8_t slot)
+        {}
+
+        ///
+        /// \brief Used to send part of the response to get request as list of segments.
+        /// Called instead of sendResponse when segmented responses are enabled with
+        /// SysExConf::setSegmentedResponses. Header and request segments are built once
+        /// per request in separate buffer and point to the same memory for all parts
+        /// of the response, while part and payload segments change, so that transports
+        /// with gather DMA or writev-style output don't need to assemble the frame.
+        /// Segments are valid only during this call.
+        /// Default implementation returns false, in which case the frame is assembled
+        /// and sent using sendResponseSlot or sendResponse.
+        /// @param [in] segments    Array of segments, indexed with responseSegment_t.
+        /// @param [in] count       Number of segments in array.
+        /// \returns True if response has been sent, false otherwise.
+        ///
+        virtual bool sendResponseV([[maybe_unused]] const ResponseSegment* segments, [[maybe_unused]] uint8_t count)
+        {
+            return false;
+        }
+
+        ///
+        /// \brief Used to persist write deferred by write-behind mode.
+        /// Entries should be stored in non-volatile memory so that they can be passed
+        /// to SysExConf::replayJournal after power loss. Called only when journal is enabled.
+        /// @param [in] entry   Deferred write.
+        /// \returns True if entry has been stored, false otherwise, in which case
+        ///          the write is passed to the handler immediately.
+        ///
+        virtual bool appendJournal([[maybe_unused]] const JournalEntry& entry)
+        {
+            return false;
+        }
+
+        ///
+        /// \brief Used to discard all persisted journal entries once they're stored with set/setRange.
+        ///
+        virtual void clearJournal()
+        {}
+    };
+
+    ///
+    /// \brief Callback used to handle specific custom request.
+    /// Has the same return values as DataHandler::customRequest, context is the one
+    /// specified for the request. Plain function pointer so that tables of custom
+    /// requests can be constant and don't need any allocation.
+    ///
+    using customRequestHandler_t = uint8_t (*)(void* context, uint16_t request, DataHandler::CustomResponse& customResponse);
+
+    ///
+    /// \brief Structure containing data for single custom request.
+    ///
+    struct CustomRequest
+    {
+        uint16_t               requestId     = 0;          ///< ID byte representing specific request.
+        bool                   connOpenCheck = false;      ///< Flag indicating whether or not SysEx connection should be enabled before processing request.
+        customRequestHandler_t handler       = nullptr;    ///< Optional callback used to handle the request instead of DataHandler::customRequest.
+        void*                  context       = nullptr;    ///< Pointer passed to the callback.
     };
 }    // namespace lib::sysexconf
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "common.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+///
+/// \brief Optional instrumentation of message handling.
+/// Available only when the library is built with SYS_EX_CONF_STATS defined,
+/// otherwise none of the counters are stored or updated.
+/// @{
+///
+
+namespace lib::sysexconf
+{
+    ///
+    /// \brief Number of buckets in latency histograms.
+    /// Bucket 0 holds requests handled in 0 clock ticks, bucket N holds requests
+    /// handled in [2^(N-1), 2^N) ticks and the last one holds all slower requests.
+    ///
+    constexpr uint8_t STATS_LATENCY_BUCKETS = 16;
+
+    ///
+    /// \brief Number of wishes with separate counters (get, set and backup).
+    ///
+    constexpr uint8_t STATS_WISHES = 3;
+
+    ///
+    /// \brief Number of amounts with separate counters (single, all and changed).
+    ///
+    constexpr uint8_t STATS_AMOUNTS = 3;
+
+    ///
+    /// \brief Number of statuses with separate counters.
+    ///
+    constexpr uint8_t STATS_STATUSES = 16;
+
+    ///
+    /// \brief Counter shared by all statuses not listed in status_t, such as custom
+    /// errors returned by the data handler.
+    ///
+    constexpr uint8_t STATS_STATUS_OTHER = STATS_STATUSES - 1;
+
+    static_assert(static_cast<uint8_t>(status_t::ERROR_READ) < STATS_STATUS_OTHER, "Status counters overlap");
+
+    ///
+    /// \brief Function returning current time in arbitrary unit, usually CPU cycles or microseconds.
+    /// Differences are computed with unsigned arithmetic so the counter is allowed to wrap.
+    ///
+    using statsClock_t = uint32_t (*)();
+
+    ///
+    /// \brief Snapshot of all counters.
+    /// Counters are transferred with special request in the same order as they're declared.
+    ///
+    struct Stats
+    {
+        uint32_t frames          = 0;    ///< Frames meant for this device.
+        uint32_t foreignFrames   = 0;    ///< Frames meant for other devices.
+        uint32_t droppedFrames   = 0;    ///< Malformed, truncated and oversized frames.
+        uint32_t responses       = 0;    ///< Sent responses.
+        uint32_t responseBytes   = 0;    ///< Total size of sent responses.
+        uint32_t specialRequests = 0;    ///< Handled special requests.
+
+        uint32_t requests[STATS_WISHES][STATS_AMOUNTS]                       = {};    ///< Handled standard requests.
+        uint32_t statuses[STATS_STATUSES]                                    = {};    ///< Resulting status of handled requests.
+        uint32_t latency[STATS_WISHES][STATS_AMOUNTS][STATS_LATENCY_BUCKETS] = {};    ///< Latency of standard requests.
+        uint32_t specialLatency[STATS_LATENCY_BUCKETS]                       = {};    ///< Latency of special requests.
+        uint32_t statusLatency[STATS_STATUSES][STATS_LATENCY_BUCKETS]        = {};    ///< Latency of requests by resulting status.
+    };
+
+    ///
+    /// \brief Total number of counters.
+    ///
+    constexpr size_t STATS_COUNTERS = sizeof(Stats) / sizeof(uint32_t);
+
+    static_assert(sizeof(Stats) == (STATS_COUNTERS * sizeof(uint32_t)), "Stats must contain only counters");
+}    // namespace lib::sysexconf
+
+/// @}
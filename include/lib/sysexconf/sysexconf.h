@@ -22,6 +22,17 @@
 #pragma once
 
 #include "common.h"
+#include "codec.h"
+#include "stats.h"
+
+#include <type_traits>
+
+#include <atomic>
+#include <list>
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+#include <mutex>
+#endif
 
 ///
 /// \brief Configuration protocol created using custom SysEx MIDI messages.
@@ -30,6 +41,186 @@
 
 namespace lib::sysexconf
 {
+    ///
+    /// \brief State of the configuration session on single port.
+    /// Holds everything which depends on the traffic on the port: connection state,
+    /// values negotiated with the host, stream parser, response buffer and position
+    /// within paused transfers. Layout, custom requests and storage related state are
+    /// kept in SysExConf so that devices exposing multiple ports (USB, DIN, BLE) can
+    /// serve all of them with single engine.
+    ///
+    class Session
+    {
+        public:
+        explicit Session(uint8_t port = 0)
+            : _port(port)
+        {}
+
+        Session(const Session&)            = delete;
+        Session& operator=(const Session&) = delete;
+
+        uint8_t port() const
+        {
+            return _port;
+        }
+
+        bool isConfigurationEnabled() const
+        {
+            return _sysExEnabled;
+        }
+
+        private:
+        friend class SysExConf;
+
+        ///
+        /// \brief Descriptive list of stream parser states.
+        ///
+        enum class streamState_t : uint8_t
+        {
+            IDLE,       ///< Waiting for start of the message.
+            HEADER,     ///< Receiving manufacturer ID.
+            BODY,       ///< Receiving rest of the message meant for this device.
+            DISCARD,    ///< Skipping message until the next status byte.
+        };
+
+        ///
+        /// \brief Structure holding position within multi-part transfer paused by flow control.
+        ///
+        struct TransferCursor
+        {
+            uint8_t request[STD_REQ_MIN_MSG_SIZE]           = {};             ///< Request for all parts of the section being transferred.
+            uint8_t nextPart                                = 0;              ///< Next part of the section to send.
+            bool    sectionPaused                           = false;          ///< Flag indicating that section transfer is paused.
+            uint8_t dumpRequest[SPECIAL_REQ_VALUE_MSG_SIZE] = {};             ///< Dump request, sent back as final ACK.
+            uint8_t dumpRequestSize                         = 0;              ///< Dump request size.
+            wish_t  dumpWish                                = wish_t::GET;    ///< Wish used for all dumped sections.
+            uint8_t block                                   = 0;              ///< Next block to dump.
+            uint8_t section                                 = 0;              ///< Next section to dump.
+            bool    dumpPaused                              = false;          ///< Flag indicating that dump is paused.
+        };
+
+        ///
+        /// \brief Value indicating that response isn't being built in response ring slot.
+        ///
+        static constexpr uint8_t NO_RESPONSE_SLOT = 0xFF;
+
+        ///
+        /// \brief Port number passed back to the data handler while this session is active.
+        ///
+        const uint8_t _port;
+
+        ///
+        /// \brief Flag indicating whether or not configuration is possible on this port.
+        ///
+        bool _sysExEnabled = false;
+
+        ///
+        /// \brief Structure containing decoded data from SysEx request for easier access.
+        ///
+        DecodedMessage _decodedMessage = {};
+
+        ///
+        /// \brief Array in which response will be stored.
+        ///
+        uint8_t _responseArray[MAX_MESSAGE_SIZE] = {};
+
+        ///
+        /// \brief Holds current size of response array.
+        ///
+        uint16_t _responseCounter = 0;
+
+        ///
+        /// \brief Buffer in which response is currently being built.
+        /// Points either to response array or to acquired response ring slot.
+        ///
+        uint8_t* _response = _responseArray;
+
+        ///
+        /// \brief Index of the slot in which response is currently being built.
+        ///
+        uint8_t _responseSlot = NO_RESPONSE_SLOT;
+
+        ///
+        /// \brief Header of the response sent as segments, built once per request.
+        ///
+        uint8_t _responseHeader[STD_REQ_MIN_MSG_SIZE] = {};
+
+        ///
+        /// \brief Size of the response header, 0 if the response isn't sent as segments.
+        /// While the response is sent as segments, response buffer holds only the payload.
+        ///
+        uint16_t _responseHeaderSize = 0;
+
+        ///
+        /// \brief Message part of the response sent as segments.
+        ///
+        uint8_t _responsePart = 0;
+
+        ///
+        /// \brief Current state of the stream parser.
+        ///
+        streamState_t _streamState = streamState_t::IDLE;
+
+        ///
+        /// \brief Number of bytes stream parser has stored in response array.
+        ///
+        uint16_t _streamCounter = 0;
+
+        ///
+        /// \brief Array in which response packed into USB MIDI event packets will be stored.
+        ///
+        uint8_t _usbMidiArray[USB_MIDI_MAX_MESSAGE_SIZE] = {};
+
+        ///
+        /// \brief Flag indicating whether or not message currently being handled
+        /// has been received in USB MIDI event packets.
+        ///
+        bool _usbMidiActive = false;
+
+        ///
+        /// \brief Virtual cable on which last USB MIDI event packet has been received.
+        ///
+        uint8_t _usbMidiCable = 0;
+
+        ///
+        /// \brief Number of parameters per message negotiated for this session.
+        ///
+        uint16_t _paramsPerMessage = PARAMS_PER_MESSAGE;
+
+        ///
+        /// \brief Encoding of values for all parameters negotiated for this session.
+        ///
+        compression_t _compression = compression_t::NONE;
+
+        ///
+        /// \brief Number of multi-part response frames which can be sent without acknowledgement
+        /// negotiated for this session. Set to 0 when flow control isn't used.
+        ///
+        uint16_t _windowSize = 0;
+
+        ///
+        /// \brief Number of response frames which can still be sent before waiting for acknowledgement.
+        ///
+        uint16_t _windowCredits = 0;
+
+        ///
+        /// \brief Flag indicating that paused section transfer is being resumed.
+        ///
+        bool _transferResuming = false;
+
+        ///
+        /// \brief Position within multi-part transfer paused by flow control.
+        ///
+        TransferCursor _transfer = {};
+
+#ifdef SYS_EX_CONF_STATS
+        ///
+        /// \brief Status of the last response sent while handling current request.
+        ///
+        uint8_t _statsStatus = 0;
+#endif
+    };
+
     class SysExConf
     {
         public:
@@ -37,19 +228,70 @@ namespace lib::sysexconf
                   const ManufacturerId& manufacturerId)
             : _dataHandler(dataHandler)
             , _manufacturerId(manufacturerId)
-        {}
+        {
+            _customRequestTable.fill(NO_CUSTOM_REQUEST);
+        }
+
+        virtual ~SysExConf() = default;
+
+        void     reset();
+        void     reset(Session& session);
+        bool     setLayout(std::vector<Block>& layout);
+        bool     setupCustomRequests(std::vector<CustomRequest>& customRequests);
+        void     handleMessage(const uint8_t* array, uint16_t size);
+        void     handleMessage(Session& session, const uint8_t* array, uint16_t size);
+        void     feedByte(uint8_t data);
+        void     feedByte(Session& session, uint8_t data);
+        void     feed(const uint8_t* data, uint16_t size);
+        void     feed(Session& session, const uint8_t* data, uint16_t size);
+        void     feedUsbMidiPacket(const uint8_t* packet);
+        void     feedUsbMidi(const uint8_t* packets, uint16_t size);
+        void     feedUsbMidi(Session& session, const uint8_t* packets, uint16_t size);
+        bool     isConfigurationEnabled();
+        uint8_t  port() const;
+        void     setUserErrorIgnoreMode(bool state);
+        bool     isUserErrorIgnoreModeEnabled() const;
+        void     sendCustomMessage(const uint16_t* values, uint16_t size, bool ack = true);
+        bool     setResponseRing(uint8_t* buffer, uint8_t numberOfSlots);
+        void     releaseResponseSlot(uint8_t slot);
+        void     setSegmentedResponses(bool state);
+        uint8_t  blocks() const;
+        uint8_t  sections(uint8_t blockIndex) const;
+        uint16_t      paramsPerMessage() const;
+        compression_t compression() const;
+        uint32_t parameters() const;
+        uint16_t parameters(uint8_t block, uint8_t section) const;
+        bool     setCache(bool state);
+        bool     fillCache();
+        void     invalidateCache();
+        void     invalidateCache(uint8_t block, uint8_t section);
+        void     invalidateCache(uint8_t block, uint8_t section, uint16_t index);
+        bool     setDirtyTracking(bool state);
+        void     notifyChanged(uint8_t block, uint8_t section, uint16_t index);
+        void     checkpoint();
+        bool     setWriteBehind(bool state, uint32_t idleTime = 0, uint16_t journalSize = 0);
+        bool     flush();
+        void     update(uint32_t currentTime);
+        bool     replayJournal(const JournalEntry* entries, uint16_t count);
+        bool     setStagedWrites(bool state);
 
-        void    reset();
-        bool    setLayout(std::vector<Block>& layout);
-        bool    setupCustomRequests(std::vector<CustomRequest>& customRequests);
-        void    handleMessage(const uint8_t* array, uint16_t size);
-        bool    isConfigurationEnabled();
-        void    setUserErrorIgnoreMode(bool state);
-        void    sendCustomMessage(const uint16_t* values, uint16_t size, bool ack = true);
-        uint8_t blocks() const;
-        uint8_t sections(uint8_t blockIndex) const;
+#ifdef SYS_EX_CONF_STATS
+        void  setStatsClock(statsClock_t clock);
+        Stats stats() const;
+        void  resetStats();
+#endif
+
+        protected:
+        void setLayout(const SectionDescriptor* sections, const BlockDescriptor* blocks, uint8_t numberOfBlocks);
+
+        virtual bool handleStandardRequest(const uint8_t* receivedArray, uint16_t receivedArraySize);
+
+        template<typename Handler>
+        bool processStandardRequest(Handler& handler, const uint8_t* receivedArray, uint16_t receivedArraySize);
 
         private:
+        friend class SysExConfAsync;
+
         ///
         /// \brief Reference to object performing reading and writing of actual data.
         ///
@@ -61,19 +303,87 @@ namespace lib::sysexconf
         const ManufacturerId& _manufacturerId;
 
         ///
-        /// \brief Array in which response will be stored.
+        /// \brief Session used when messages are handled without specifying the port.
         ///
-        uint8_t _responseArray[MAX_MESSAGE_SIZE] = {};
+        Session _defaultSession;
 
+#ifdef SYS_EX_CONF_THREAD_SAFE
         ///
-        /// \brief Holds current size of response array.
+        /// \brief Engine and session whose request is being handled on the current thread.
         ///
-        uint16_t _responseCounter = 0;
+        struct ActiveSession
+        {
+            const SysExConf* engine;
+            Session*         session;
+        };
 
         ///
-        /// \brief Flag indicating whether or not configuration is possible.
+        /// \brief Session active on the current thread. Kept per thread so that requests
+        /// received on different sessions can be handled concurrently.
         ///
-        bool _sysExEnabled = false;
+        static inline thread_local ActiveSession _activeSession;
+
+        ///
+        /// \brief Mutex guarding state shared by all sessions: shadow value cache, dirty tracking,
+        /// deferred and staged writes and response ring. Recursive so that public functions
+        /// locking it can be used internally as well. Not held while values are retrieved from
+        /// or stored by the data handler during requests, so that sessions don't wait for each
+        /// other's storage access. Deferred values are the exception since they must be stored in order.
+        ///
+        mutable std::recursive_mutex _stateMutex;
+
+        ///
+        /// \brief Incremented whenever stored values change. Values retrieved from the data handler
+        /// without holding the state lock are cached only if nothing has been written meanwhile.
+        /// Atomic since it's sampled before the value is retrieved, outside of the state lock.
+        ///
+        std::atomic<uint32_t> _cacheGeneration = 0;
+#else
+        ///
+        /// \brief Session whose request is currently being handled.
+        ///
+        Session* _session = &_defaultSession;
+#endif
+
+        ///
+        /// \brief Flag indicating whether or not responses to get requests are sent with DataHandler::sendResponseV.
+        ///
+        bool _segmentedResponsesEnabled = false;
+
+        ///
+        /// \brief User-provided memory holding response ring slots, MAX_MESSAGE_SIZE bytes each.
+        ///
+        uint8_t* _responseRing = nullptr;
+
+        ///
+        /// \brief Total number of slots in response ring.
+        ///
+        uint8_t _responseRingSlots = 0;
+
+        ///
+        /// \brief Index of the slot which will be acquired for next response.
+        ///
+        uint8_t _responseRingNext = 0;
+
+        ///
+        /// \brief Flags indicating that the slot is in use, either by the engine building
+        /// the response or by the transport it has been handed over to.
+        /// Cleared by the transport once the response is transmitted.
+        ///
+        std::array<std::atomic<bool>, MAX_RESPONSE_SLOTS> _responseSlotBusy = {};
+
+#ifdef SYS_EX_CONF_STATS
+        ///
+        /// \brief Counters laid out in the same way as Stats structure.
+        /// Counters are updated with relaxed atomic operations so that they can be read from other threads.
+        ///
+        std::array<std::atomic<uint32_t>, STATS_COUNTERS> _stats = {};
+
+        ///
+        /// \brief Function used to measure latency. Latency isn't measured if not set.
+        ///
+        statsClock_t _statsClock = nullptr;
+#endif
 
         ///
         /// \brief Flag indicating whether or not user error ignore mode is active.
@@ -84,27 +394,176 @@ namespace lib::sysexconf
         bool _userErrorIgnoreModeEnabled = false;
 
         ///
-        /// \brief SysEx layout.
+        /// \brief Flattened data for all sections in runtime layout.
+        /// Built once in setLayout so that all section data can be retrieved
+        /// with single indexed lookup.
         ///
-        std::vector<Block>* _layout = {};
+        std::vector<SectionDescriptor> _sectionTable = {};
 
         ///
-        /// \brief Structure containing decoded data from SysEx request for easier access.
+        /// \brief Flattened data for all blocks in runtime layout.
+        ///
+        std::vector<BlockDescriptor> _blockTable = {};
+
+        ///
+        /// \brief Section data of the active layout.
+        /// Points either to the flattened runtime layout or to the constant
+        /// tables of the layout known at compile time.
+        ///
+        const SectionDescriptor* _sections = nullptr;
+
+        ///
+        /// \brief Block data of the active layout.
+        ///
+        const BlockDescriptor* _blocks = nullptr;
+
+        ///
+        /// \brief Number of blocks in the active layout.
+        ///
+        uint8_t _blockCount = 0;
+
+        ///
+        /// \brief Flag indicating whether or not values are cached in shadow value cache.
+        ///
+        bool _cacheEnabled = false;
+
+        ///
+        /// \brief Shadow value cache holding values of all parameters in layout.
+        /// Value of each parameter is located at its section offset increased by parameter index.
+        ///
+        std::vector<uint16_t> _cache = {};
+
+        ///
+        /// \brief Bitmap indicating which values in shadow value cache are valid.
+        ///
+        std::vector<uint32_t> _cacheValid = {};
+
+        ///
+        /// \brief Flag indicating whether or not changes of parameters are tracked.
+        ///
+        bool _dirtyTrackingEnabled = false;
+
+        ///
+        /// \brief Bitmap indicating which parameters have been changed and haven't been reported yet.
+        /// Indexed in the same way as shadow value cache.
+        ///
+        std::vector<uint32_t> _dirty = {};
+
+        ///
+        /// \brief Bitmap indicating which parameters have been reported as changed,
+        /// but the host hasn't acknowledged them with checkpoint request yet.
         ///
-        DecodedMessage _decodedMessage;
+        std::vector<uint32_t> _reported = {};
+
+        ///
+        /// \brief Flag indicating whether or not writes are deferred and coalesced.
+        ///
+        bool _writeBehindEnabled = false;
+
+        ///
+        /// \brief Time without new writes after which deferred writes are flushed in update.
+        /// Set to 0 to flush only on connection close or explicit flush.
+        ///
+        uint32_t _writeBehindIdleTime = 0;
+
+        ///
+        /// \brief Maximum number of deferred writes in journal. Set to 0 to disable the journal.
+        ///
+        uint16_t _journalSize = 0;
+
+        ///
+        /// \brief Number of deferred writes persisted in journal since last flush.
+        ///
+        uint16_t _journalEntries = 0;
+
+        ///
+        /// \brief Deferred values for all parameters in layout, indexed in the same way as shadow value cache.
+        ///
+        std::vector<uint16_t> _pendingValues = {};
+
+        ///
+        /// \brief Bitmap indicating which parameters have deferred value.
+        ///
+        std::vector<uint32_t> _pending = {};
+
+        ///
+        /// \brief Flag indicating whether or not there's at least one deferred value.
+        ///
+        bool _pendingWrites = false;
+
+        ///
+        /// \brief Flag indicating that value has been deferred since last update call.
+        ///
+        bool _deferredSinceUpdate = false;
+
+        ///
+        /// \brief Time of the update call following the last deferred write.
+        ///
+        uint32_t _lastWriteTime = 0;
+
+        ///
+        /// \brief Flag indicating whether or not set requests for all parameters
+        /// in sections with multiple parts are staged until the last part arrives.
+        ///
+        bool _stagedWritesEnabled = false;
+
+        ///
+        /// \brief Structure holding values of a section staged by single session.
+        ///
+        struct Stage
+        {
+            const Session*          session    = nullptr;    ///< Session staging the values, nullptr if the stage is unused.
+            uint8_t                 block      = 0;          ///< Block of the section whose values are being staged.
+            uint8_t                 section    = 0;          ///< Section whose values are being staged.
+            uint8_t                 partCount  = 0;          ///< Number of different message parts staged so far.
+            std::array<uint32_t, 4> parts      = {};         ///< Bitmap indicating which message parts have been staged.
+            bool                    committing = false;      ///< Flag indicating that the values are being stored.
+            std::vector<uint16_t>   values     = {};         ///< Staged values of whole section.
+        };
+
+        ///
+        /// \brief Stages of all sessions. Unused stages are kept so that their buffers are reused.
+        /// List is used so that stages being stored stay in place when stages for other sessions are added.
+        ///
+        std::list<Stage> _stages = {};
 
         ///
         /// \brief Vector of structures containing data for custom requests.
         ///
         std::vector<CustomRequest> _sysExCustomRequest = {};
 
+        ///
+        /// \brief Value in custom request table indicating that custom request with that ID doesn't exist.
+        ///
+        static constexpr uint8_t NO_CUSTOM_REQUEST = 0xFF;
+
+        ///
+        /// \brief Table holding position of custom request in custom request vector for each 7-bit request ID.
+        ///
+        std::array<uint8_t, 128> _customRequestTable = {};
+
         bool     addToResponse(uint16_t value);
         bool     decode(const uint8_t* receivedArray, uint16_t receivedArraySize);
         void     resetDecodedMessage();
-        bool     processStandardRequest(uint16_t receivedArraySize);
-        bool     processSpecialRequest();
-        bool     checkManufacturerId();
-        bool     checkStatus();
+        void     abortStream();
+        bool     processSpecialRequest(const uint8_t* receivedArray, uint16_t receivedArraySize);
+        bool     processDumpRequest(const uint8_t* receivedArray, uint16_t receivedArraySize);
+        bool     continueDump();
+        bool     processWindowAck(const uint8_t* receivedArray, uint16_t receivedArraySize);
+        void     resetWindow();
+        bool     takeWindowCredit();
+        void     saveTransferRequest(const uint8_t* receivedArray);
+        void     pauseTransfer(uint8_t nextPart);
+
+#ifdef SYS_EX_CONF_STATS
+        void     countStat(size_t offset, size_t index = 0);
+        uint32_t statsTime() const;
+        void     recordRequest(uint8_t wish, uint8_t amount, bool special, uint32_t startTime);
+        void     recordResponse();
+        void     processStatsRequest(const uint8_t* receivedArray, uint16_t receivedArraySize);
+#endif
+        bool     checkManufacturerId(const uint8_t* receivedArray);
+        bool     checkStatus(const uint8_t* receivedArray);
         bool     checkWish();
         bool     checkAmount();
         bool     checkBlock();
@@ -113,19 +572,1040 @@ namespace lib::sysexconf
         bool     checkParameterIndex();
         bool     checkNewValue();
         bool     checkParameters();
+        bool     isCompressedPayload() const;
         uint16_t generateMessageLenght();
 
+        void     resizeCache();
+        bool     isCached(uint32_t position) const;
+        void     cacheValues(uint32_t position, uint16_t count, const uint16_t* values);
+        void     uncacheValues(uint32_t position, uint32_t count);
+        uint32_t position(uint16_t index) const;
+        void     resizeDirtyTracking();
+        void     markChanged(uint32_t position, uint32_t count);
+        bool     isChanged(uint32_t position) const;
+        uint16_t nextChanged(const SectionDescriptor& descriptor, uint16_t index) const;
+        void     markReported(uint32_t position);
+        void     resizeWriteBehind();
+        bool     isPending(uint32_t position) const;
+        uint8_t  deferWrites(uint16_t startIndex, uint16_t count, const uint16_t* values);
+        void     clearStaging();
+        bool     stagesSection() const;
+        Stage*   findStage(const Session* owner);
+
+        const uint16_t* stageValues(uint16_t startIndex, uint16_t count, const uint16_t* values);
+        void            mergeStaged(uint16_t startIndex, uint16_t count, const uint16_t* values);
+        void            discardStaged(const Session& owner);
+
+        const SectionDescriptor& section(uint8_t blockIndex, uint8_t sectionIndex) const;
+        uint8_t                  parts(const SectionDescriptor& descriptor) const;
+        uint16_t                 lastPartParameters(const SectionDescriptor& descriptor) const;
+
+        ///
+        /// \brief Makes the session active for the lifetime of the object.
+        /// Previously active session is restored once the object goes out of scope.
+        ///
+        class SessionScope
+        {
+            public:
+            SessionScope(SysExConf& engine, Session& session);
+            ~SessionScope();
+
+            SessionScope(const SessionScope&)            = delete;
+            SessionScope& operator=(const SessionScope&) = delete;
+
+            private:
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            ActiveSession _previous;
+#else
+            SysExConf& _engine;
+            Session*   _previous;
+#endif
+        };
+
+        Session& session()
+        {
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            return (_activeSession.engine == this) ? *_activeSession.session : _defaultSession;
+#else
+            return *_session;
+#endif
+        }
+
+        const Session& session() const
+        {
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            return (_activeSession.engine == this) ? *_activeSession.session : _defaultSession;
+#else
+            return *_session;
+#endif
+        }
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        std::lock_guard<std::recursive_mutex> lockState() const
+        {
+            return std::lock_guard<std::recursive_mutex>(_stateMutex);
+        }
+#else
+        ///
+        /// \brief Empty lock used when shared state doesn't need to be guarded.
+        ///
+        struct StateLock
+        {
+        };
+
+        StateLock lockState() const
+        {
+            return {};
+        }
+#endif
+
         template<typename T>
         void setStatus(T status)
         {
             uint8_t status_uint8 = static_cast<uint8_t>(status);
             status_uint8 &= 0x7F;
 
-            _responseArray[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = status_uint8;
+            if (session()._responseHeaderSize)
+            {
+                session()._responseHeader[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = status_uint8;
+                return;
+            }
+
+            session()._response[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = status_uint8;
+        }
+
+        void     sendResponse(bool containsLastByte, bool customMessage = false);
+        uint16_t packUsbMidi();
+        void     buildAllPartsAck();
+        bool     claimResponseSlot(uint8_t& slot);
+        void     acquireResponseSlot(uint16_t headerSize);
+        void     releaseResponse();
+        uint16_t startSegments(uint16_t headerSize);
+        void     setResponsePart(uint8_t part);
+        void     assembleResponse();
+
+        template<typename Handler>
+        bool processRange(Handler& handler, const uint8_t* receivedArray, uint16_t receivedArraySize, uint16_t startIndex, uint16_t endIndex);
+
+        template<typename Handler>
+        void sendResponse(Handler& handler, bool containsLastByte);
+
+        template<typename Handler>
+        bool processChangedRequest(Handler& handler);
+
+        template<typename Handler>
+        uint8_t readValue(Handler& handler, uint16_t index, uint16_t& value);
+
+        template<typename Handler>
+        uint8_t writeValue(Handler& handler, uint16_t index, uint16_t value);
+
+        template<typename Handler>
+        uint8_t readRange(Handler& handler, uint16_t startIndex, uint16_t count, uint16_t* values);
+
+        template<typename Handler>
+        uint8_t writeRange(Handler& handler, uint16_t startIndex, uint16_t count, const uint16_t* values);
+    };
+
+    ///
+    /// \brief Variant of the protocol with data handler type known at compile time.
+    /// Handler calls made while processing standard requests are bound statically
+    /// so that get/set/sendResponse can be inlined into the loop over message parts.
+    /// Handler class must be declared final so that calls made through it can't be
+    /// overriden. DataHandler can be used as well, in which case this variant
+    /// behaves same as SysExConf.
+    /// @tparam Handler Type of the object performing reading and writing of actual data.
+    ///
+    template<typename Handler>
+    class SysExConfDirect : public SysExConf
+    {
+        static_assert(std::is_base_of_v<DataHandler, Handler>, "Handler must be derived from DataHandler");
+        static_assert(std::is_same_v<Handler, DataHandler> || std::is_final_v<Handler>, "Handler must be declared final");
+
+        public:
+        SysExConfDirect(Handler&              dataHandler,
+                        const ManufacturerId& manufacturerId)
+            : SysExConf(dataHandler, manufacturerId)
+            , _handler(dataHandler)
+        {}
+
+        protected:
+        bool handleStandardRequest(const uint8_t* receivedArray, uint16_t receivedArraySize) override
+        {
+            return processStandardRequest(_handler, receivedArray, receivedArraySize);
         }
 
-        void sendResponse(bool containsLastByte, bool customMessage = false);
+        private:
+        Handler& _handler;
+    };
+
+    ///
+    /// \brief Variant of the protocol with layout known at compile time.
+    /// Layout is validated during compilation and all section data is read from
+    /// precomputed constant tables.
+    /// @tparam LAYOUT  Reference to constexpr StaticLayout object.
+    /// @tparam Handler Type of the object performing reading and writing of actual data.
+    ///                 See SysExConfDirect.
+    ///
+    template<const auto& LAYOUT, typename Handler = DataHandler>
+    class SysExConfStatic : public SysExConfDirect<Handler>
+    {
+        static_assert(LAYOUT.valid(), "Layout can't be addressed by the protocol");
+
+        public:
+        SysExConfStatic(Handler&              dataHandler,
+                        const ManufacturerId& manufacturerId)
+            : SysExConfDirect<Handler>(dataHandler, manufacturerId)
+        {
+            SysExConf::setLayout(LAYOUT.sections(), LAYOUT.blocks(), LAYOUT.BLOCKS);
+        }
+
+        using SysExConf::reset;
+
+        void reset()
+        {
+            SysExConf::reset();
+            SysExConf::setLayout(LAYOUT.sections(), LAYOUT.blocks(), LAYOUT.BLOCKS);
+        }
     };
+
+    ///
+    /// \brief Used to process standard SysEx request.
+    /// Defined here so that the loop over message parts can be instantiated
+    /// with handler type known at compile time.
+    /// @param [in] handler             Object performing reading and writing of actual data.
+    /// @param [in] receivedArray       Request array.
+    /// @param [in] receivedArraySize   Request array size.
+    /// \returns True on success, false otherwise.
+    ///
+    template<typename Handler>
+    bool SysExConf::processStandardRequest(Handler& handler, const uint8_t* receivedArray, uint16_t receivedArraySize)
+    {
+        uint16_t startIndex = 0, endIndex = 1;
+        uint16_t msgPartsLoop = 1, responseCounterLocal = session()._responseCounter;
+        uint8_t  firstPart    = 0;
+        bool     allPartsAck  = false;
+        bool     allPartsLoop = false;
+        auto&    descriptor   = section(session()._decodedMessage.block, session()._decodedMessage.section);
+
+        if (session()._decodedMessage.amount == amount_t::CHANGED)
+        {
+            return processChangedRequest(handler);
+        }
+
+        if ((session()._decodedMessage.wish == wish_t::BACKUP) || (session()._decodedMessage.wish == wish_t::GET))
+        {
+            if ((session()._decodedMessage.part == 127) || (session()._decodedMessage.part == 126))
+            {
+                // when parts 127 or 126 are specified, protocol will loop over all message parts and
+                // deliver as many messages as there are parts as response
+                msgPartsLoop = parts(descriptor);
+                allPartsLoop = true;
+
+                // when part is set to 126 (0x7E), status_t::ack message will be sent as the last message
+                // indicating that all messages have been sent as response to specific request
+                if (session()._decodedMessage.part == 126)
+                {
+                    allPartsAck = true;
+                }
+
+                if (session()._transferResuming)
+                {
+                    firstPart = session()._transfer.nextPart;
+                }
+                else if (session()._windowSize)
+                {
+                    // request is modified while building the responses, keep the original one
+                    // so that the transfer can be resumed once the host acknowledges the window
+                    saveTransferRequest(receivedArray);
+                }
+            }
+
+            if (session()._decodedMessage.wish == wish_t::BACKUP)
+            {
+                // convert response to request
+                session()._responseArray[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = static_cast<uint8_t>(status_t::REQUEST);
+                // now convert wish to set
+                session()._responseArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = (uint8_t)wish_t::SET;
+                // decoded message wish needs to be set to get so that we can retrieve parameters
+                session()._decodedMessage.wish = wish_t::GET;
+                // when backup is request, erase received index/new value in response
+                responseCounterLocal = receivedArraySize - 1 - (2 * BYTES_PER_VALUE);
+            }
+        }
+
+        if ((session()._decodedMessage.wish == wish_t::GET) && (session()._decodedMessage.amount == amount_t::ALL))
+        {
+            // header is the same for all parts, only the payload is built for each part
+            responseCounterLocal = startSegments(responseCounterLocal);
+        }
+
+        for (int j = firstPart; j < msgPartsLoop; j++)
+        {
+            if (allPartsLoop && !takeWindowCredit())
+            {
+                session()._responseHeaderSize = 0;
+                pauseTransfer(j);
+                return true;
+            }
+
+            session()._responseCounter = responseCounterLocal;
+            acquireResponseSlot(responseCounterLocal);
+
+            if (allPartsLoop)
+            {
+                session()._decodedMessage.part = j;
+                setResponsePart(j);
+            }
+
+            if (session()._decodedMessage.amount == amount_t::ALL)
+            {
+                startIndex = session()._paramsPerMessage * session()._decodedMessage.part;
+                endIndex   = startIndex + session()._paramsPerMessage;
+
+                if (endIndex > descriptor.numberOfParameters)
+                {
+                    endIndex = descriptor.numberOfParameters;
+                }
+
+                if (!_userErrorIgnoreModeEnabled || (session()._compression != compression_t::NONE) || ((session()._decodedMessage.wish == wish_t::SET) && stagesSection()))
+                {
+                    // whole part is transferred with single handler call
+                    // in user error ignore mode, values are processed one by one
+                    // so that only the failed ones are ignored, unless they're compressed or staged
+                    if (!processRange(handler, receivedArray, receivedArraySize, startIndex, endIndex))
+                    {
+                        return false;
+                    }
+
+                    sendResponse(handler, false);
+                    continue;
+                }
+            }
+
+            for (uint16_t i = startIndex; i < endIndex; i++)
+            {
+                switch (session()._decodedMessage.wish)
+                {
+                case wish_t::GET:
+                {
+                    if (session()._decodedMessage.amount == amount_t::SINGLE)
+                    {
+                        if (!checkParameterIndex())
+                        {
+                            setStatus(status_t::ERROR_INDEX);
+                            return false;
+                        }
+
+                        uint16_t value  = 0;
+                        uint8_t  result = readValue(handler, session()._decodedMessage.index, value);
+
+                        switch (result)
+                        {
+                        case static_cast<uint8_t>(status_t::ACK):
+                        {
+                            addToResponse(value);
+                        }
+                        break;
+
+                        default:
+                        {
+                            if (_userErrorIgnoreModeEnabled)
+                            {
+                                value = 0;
+                                addToResponse(value);
+                            }
+                            else
+                            {
+                                setStatus(result);
+                                return false;
+                            }
+                        }
+                        break;
+                        }
+                    }
+                    else
+                    {
+                        // get all params - no index is specified
+                        uint16_t value  = 0;
+                        uint8_t  result = readValue(handler, i, value);
+
+                        switch (result)
+                        {
+                        case static_cast<uint8_t>(status_t::ACK):
+                        {
+                            addToResponse(value);
+                        }
+                        break;
+
+                        default:
+                        {
+                            if (_userErrorIgnoreModeEnabled)
+                            {
+                                value = 0;
+                                addToResponse(value);
+                            }
+                            else
+                            {
+                                setStatus(result);
+                                return false;
+                            }
+                        }
+                        break;
+                        }
+                    }
+                }
+                break;
+
+                default:
+                {
+                    // case wish_t::set:
+                    if (session()._decodedMessage.amount == amount_t::SINGLE)
+                    {
+                        if (!checkParameterIndex())
+                        {
+                            setStatus(status_t::ERROR_INDEX);
+                            return false;
+                        }
+
+                        if (!checkNewValue())
+                        {
+                            setStatus(status_t::ERROR_NEW_VALUE);
+                            return false;
+                        }
+
+                        uint8_t result = writeValue(handler, session()._decodedMessage.index, session()._decodedMessage.newValue);
+
+                        switch (result)
+                        {
+                        case static_cast<uint8_t>(status_t::ACK):
+                            break;
+
+                        default:
+                        {
+                            if (!_userErrorIgnoreModeEnabled)
+                            {
+                                setStatus(result);
+                                return false;
+                            }
+                        }
+                        break;
+                        }
+                    }
+                    else
+                    {
+                        uint16_t arrayIndex = (i - startIndex);
+
+                        arrayIndex *= BYTES_PER_VALUE;
+                        arrayIndex += static_cast<uint8_t>(byteOrder_t::INDEX_BYTE);
+
+                        // merge new value straight from the request
+                        auto merge                         = Merge14Bit(receivedArray[arrayIndex], receivedArray[arrayIndex + 1]);
+                        session()._decodedMessage.newValue = merge.value();
+
+                        if (!checkNewValue())
+                        {
+                            setStatus(status_t::ERROR_NEW_VALUE);
+                            return false;
+                        }
+
+                        uint8_t result = writeValue(handler, i, session()._decodedMessage.newValue);
+
+                        switch (result)
+                        {
+                        case static_cast<uint8_t>(status_t::ACK):
+                            break;
+
+                        default:
+                        {
+                            if (!_userErrorIgnoreModeEnabled)
+                            {
+                                setStatus(result);
+                                return false;
+                            }
+                        }
+                        break;
+                        }
+                    }
+                }
+                break;
+                }
+            }
+
+            sendResponse(handler, false);
+        }
+
+        session()._responseHeaderSize = 0;
+
+        if (allPartsAck)
+        {
+            if (!takeWindowCredit())
+            {
+                pauseTransfer(msgPartsLoop);
+                return true;
+            }
+
+            // send status_t::ack message at the end
+            buildAllPartsAck();
+            sendResponse(handler, false);
+        }
+
+        return true;
+    }
+
+    ///
+    /// \brief Used to process single part of request with all parameters.
+    /// Values are retrieved or stored with single handler call. For set requests,
+    /// all values in the part are validated before anything is stored. When staged
+    /// writes are enabled, values for sections with multiple parts are stored only
+    /// once all parts have been received, with single handler call for whole section.
+    /// Values are run-length coded if that encoding has been negotiated for the session.
+    /// @param [in] handler             Object performing reading and writing of actual data.
+    /// @param [in] receivedArray       Request array.
+    /// @param [in] receivedArraySize   Request array size.
+    /// @param [in] startIndex          Index of first parameter in part.
+    /// @param [in] endIndex            Index after the last parameter in part.
+    /// \returns True on success, false otherwise.
+    ///
+    template<typename Handler>
+    bool SysExConf::processRange(Handler& handler, const uint8_t* receivedArray, uint16_t receivedArraySize, uint16_t startIndex, uint16_t endIndex)
+    {
+        uint16_t values[MAX_PARAMS_PER_MESSAGE];
+        uint16_t count  = endIndex - startIndex;
+        uint8_t  result = static_cast<uint8_t>(status_t::ACK);
+
+        if (session()._decodedMessage.wish == wish_t::GET)
+        {
+            result = readRange(handler, startIndex, count, values);
+
+            if (result != static_cast<uint8_t>(status_t::ACK))
+            {
+                if (!_userErrorIgnoreModeEnabled)
+                {
+                    setStatus(result);
+                    return false;
+                }
+
+                // retrieve values one by one so that only the failed ones are ignored
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    if (readValue(handler, startIndex + i, values[i]) != static_cast<uint8_t>(status_t::ACK))
+                    {
+                        values[i] = 0;
+                    }
+                }
+            }
+
+            // whole part is encoded in single batch, space for it is guaranteed by part size
+            if (session()._compression == compression_t::RLE)
+            {
+                session()._responseCounter += encodeRle(values, &session()._response[session()._responseCounter], count);
+            }
+            else
+            {
+                encode14Bit(values, &session()._response[session()._responseCounter], count);
+                session()._responseCounter += count * BYTES_PER_VALUE;
+            }
+
+            return true;
+        }
+
+        // case wish_t::set:
+        if (session()._compression == compression_t::RLE)
+        {
+            uint16_t size = receivedArraySize - static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) - 1;
+
+            if (!decodeRle(&receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)], size, values, count))
+            {
+                discardStaged(session());
+                setStatus(status_t::ERROR_MESSAGE_LENGTH);
+                return false;
+            }
+        }
+        else
+        {
+            decode14Bit(&receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)], values, count);
+        }
+
+        for (uint16_t i = 0; i < count; i++)
+        {
+            session()._decodedMessage.newValue = values[i];
+
+            if (!checkNewValue())
+            {
+                // rejected part aborts the whole staged section
+                discardStaged(session());
+                setStatus(status_t::ERROR_NEW_VALUE);
+                return false;
+            }
+        }
+
+        if (stagesSection())
+        {
+            const uint16_t* staged = nullptr;
+
+            {
+                [[maybe_unused]] auto lock = lockState();
+
+                staged = stageValues(startIndex, count, values);
+            }
+
+            if (staged == nullptr)
+            {
+                // more parts are needed
+                return true;
+            }
+
+            auto& descriptor = section(session()._decodedMessage.block, session()._decodedMessage.section);
+
+            result = writeRange(handler, 0, descriptor.numberOfParameters, staged);
+            discardStaged(session());
+        }
+        else
+        {
+            result = writeRange(handler, startIndex, count, values);
+        }
+
+        if ((result != static_cast<uint8_t>(status_t::ACK)) && !_userErrorIgnoreModeEnabled)
+        {
+            setStatus(result);
+            return false;
+        }
+
+        return true;
+    }
+
+    ///
+    /// \brief Used to send SysEx response.
+    /// @param [in] handler          Object used to send the response.
+    /// @param [in] containsLastByte If set to true, last SysEx byte (0xF7) won't be appended.
+    ///
+    template<typename Handler>
+    void SysExConf::sendResponse(Handler& handler, bool containsLastByte)
+    {
+        if (!containsLastByte)
+        {
+            session()._response[session()._responseCounter++] = 0xF7;
+        }
+
+#ifdef SYS_EX_CONF_STATS
+        recordResponse();
+#endif
+
+        if (session()._responseHeaderSize)
+        {
+            constexpr uint8_t PART_BYTE  = static_cast<uint8_t>(byteOrder_t::PART_BYTE);
+            uint16_t          headerSize = session()._responseHeaderSize;
+
+            const ResponseSegment SEGMENTS[static_cast<uint8_t>(responseSegment_t::AMOUNT)] = {
+                { &session()._responseHeader[0], PART_BYTE },
+                { &session()._responsePart, 1 },
+                { &session()._responseHeader[PART_BYTE + 1], static_cast<uint16_t>(headerSize - PART_BYTE - 1) },
+                { &session()._response[0], session()._responseCounter },
+            };
+
+            if (!session()._usbMidiActive && handler.sendResponseV(SEGMENTS, static_cast<uint8_t>(responseSegment_t::AMOUNT)))
+            {
+                releaseResponse();
+                return;
+            }
+
+            assembleResponse();
+        }
+
+        if (session()._usbMidiActive)
+        {
+            if (handler.sendUsbMidiResponse(session()._usbMidiArray, packUsbMidi()))
+            {
+                releaseResponse();
+                return;
+            }
+        }
+
+        if (session()._responseSlot != Session::NO_RESPONSE_SLOT)
+        {
+            if (handler.sendResponseSlot(session()._responseSlot, session()._response, session()._responseCounter))
+            {
+                // slot is now owned by the transport
+                session()._responseSlot = Session::NO_RESPONSE_SLOT;
+                session()._response     = session()._responseArray;
+                return;
+            }
+        }
+
+        handler.sendResponse(session()._response, session()._responseCounter);
+        releaseResponse();
+    }
+
+    ///
+    /// \brief Used to process get request for parameters changed since last checkpoint.
+    /// Response contains index/value pairs of changed parameters in ascending index order,
+    /// half of the parameters per message pairs per message part. Part selects which pairs
+    /// are sent, while parts 126 and 127 send as many parts as needed for all changed
+    /// parameters (at least one), up to MAX_PARTS parts. Reported parameters are considered
+    /// changed until the host acknowledges them with checkpoint request, so parameters which
+    /// didn't fit are reported once the host acknowledges the ones sent and requests them again.
+    /// @param [in] handler Object performing reading and writing of actual data.
+    /// \returns True on success, false otherwise.
+    ///
+    template<typename Handler>
+    bool SysExConf::processChangedRequest(Handler& handler)
+    {
+        auto&    descriptor   = section(session()._decodedMessage.block, session()._decodedMessage.section);
+        uint16_t headerSize   = session()._responseCounter;
+        uint16_t pairsPerPart = session()._paramsPerMessage / 2;
+        bool     allPartsLoop = (session()._decodedMessage.part == 127) || (session()._decodedMessage.part == 126);
+        uint8_t  part         = allPartsLoop ? 0 : session()._decodedMessage.part;
+        uint16_t index        = 0;
+
+        {
+            // changes are tracked for all sessions, lock is held only while they're inspected
+            [[maybe_unused]] auto lock = lockState();
+
+            index = nextChanged(descriptor, 0);
+
+            // skip pairs sent in previous parts
+            for (uint32_t skip = static_cast<uint32_t>(part) * pairsPerPart; skip && (index < descriptor.numberOfParameters); skip--)
+            {
+                index = nextChanged(descriptor, index + 1);
+            }
+        }
+
+        // header is the same for all parts, only the payload is built for each part
+        headerSize = startSegments(headerSize);
+
+        do
+        {
+            session()._responseCounter = headerSize;
+            acquireResponseSlot(headerSize);
+            setResponsePart(part++);
+
+            for (uint16_t pairs = 0; (pairs < pairsPerPart) && (index < descriptor.numberOfParameters); pairs++)
+            {
+                uint16_t value  = 0;
+                uint8_t  result = readValue(handler, index, value);
+
+                if (result != static_cast<uint8_t>(status_t::ACK))
+                {
+                    if (!_userErrorIgnoreModeEnabled)
+                    {
+                        setStatus(result);
+                        return false;
+                    }
+
+                    value = 0;
+                }
+
+                addToResponse(index);
+                addToResponse(value);
+
+                [[maybe_unused]] auto lock = lockState();
+
+                markReported(position(index));
+                index = nextChanged(descriptor, index + 1);
+            }
+
+            sendResponse(handler, false);
+        } while (allPartsLoop && (part < MAX_PARTS) && (index < descriptor.numberOfParameters));
+
+        session()._responseHeaderSize = 0;
+
+        if (session()._decodedMessage.part == 126)
+        {
+            // send status_t::ack message at the end
+            buildAllPartsAck();
+            sendResponse(handler, false);
+        }
+
+        return true;
+    }
+
+    ///
+    /// \brief Used to retrieve single value from current section.
+    /// Value is served from shadow value cache if possible.
+    /// @param [in] handler     Object performing reading and writing of actual data.
+    /// @param [in] index       Parameter index.
+    /// @param [out] value      Retrieved value.
+    /// \returns status_t::ACK on success, error status otherwise.
+    ///
+    template<typename Handler>
+    uint8_t SysExConf::readValue(Handler& handler, uint16_t index, uint16_t& value)
+    {
+        {
+            [[maybe_unused]] auto lock = lockState();
+
+            if (_writeBehindEnabled && isPending(position(index)))
+            {
+                value = _pendingValues[position(index)];
+                return static_cast<uint8_t>(status_t::ACK);
+            }
+
+            if (_cacheEnabled && isCached(position(index)))
+            {
+                value = _cache[position(index)];
+                return static_cast<uint8_t>(status_t::ACK);
+            }
+        }
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        uint32_t generation = _cacheGeneration;
+#endif
+
+        uint8_t result = handler.get(session()._decodedMessage.block, session()._decodedMessage.section, index, value);
+
+        if (_cacheEnabled && (result == static_cast<uint8_t>(status_t::ACK)))
+        {
+            [[maybe_unused]] auto lock = lockState();
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            // value written meanwhile could be newer than the retrieved one
+            if (generation != _cacheGeneration)
+            {
+                return result;
+            }
+#endif
+
+            cacheValues(position(index), 1, &value);
+        }
+
+        return result;
+    }
+
+    ///
+    /// \brief Used to store single value in current section.
+    /// Shadow value cache is updated only once the handler stores the value.
+    /// When write-behind is enabled, value is deferred instead of being passed to the handler.
+    /// @param [in] handler     Object performing reading and writing of actual data.
+    /// @param [in] index       Parameter index.
+    /// @param [in] value       Value to store.
+    /// \returns status_t::ACK on success, error status otherwise.
+    ///
+    template<typename Handler>
+    uint8_t SysExConf::writeValue(Handler& handler, uint16_t index, uint16_t value)
+    {
+        uint8_t result   = static_cast<uint8_t>(status_t::ACK);
+        bool    deferred = false;
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        uint32_t generation = 0;
+#endif
+
+        {
+            [[maybe_unused]] auto lock = lockState();
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            generation = ++_cacheGeneration;
+#endif
+
+            deferred = _writeBehindEnabled;
+
+            if (deferred)
+            {
+                result = deferWrites(index, 1, &value);
+            }
+        }
+
+        if (!deferred)
+        {
+            result = handler.set(session()._decodedMessage.block, session()._decodedMessage.section, index, value);
+        }
+
+        [[maybe_unused]] auto lock = lockState();
+
+        if (result == static_cast<uint8_t>(status_t::ACK))
+        {
+            mergeStaged(index, 1, &value);
+
+            if (_dirtyTrackingEnabled)
+            {
+                markChanged(position(index), 1);
+            }
+        }
+
+        if (_cacheEnabled)
+        {
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            // with other writes completed meanwhile, order in which values were stored is unknown
+            bool cache = (result == static_cast<uint8_t>(status_t::ACK)) && (generation == _cacheGeneration);
+#else
+            bool cache = result == static_cast<uint8_t>(status_t::ACK);
+#endif
+
+            if (cache)
+            {
+                cacheValues(position(index), 1, &value);
+            }
+            else
+            {
+                // state of the storage is unknown after failed write
+                uncacheValues(position(index), 1);
+            }
+        }
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        // values retrieved while the write was in progress could be older than the stored one
+        _cacheGeneration++;
+#endif
+
+        return result;
+    }
+
+    ///
+    /// \brief Used to retrieve multiple consecutive values from current section.
+    /// Handler is called only if any of the values isn't available in shadow value cache.
+    /// @param [in] handler     Object performing reading and writing of actual data.
+    /// @param [in] startIndex  Index of first parameter to retrieve.
+    /// @param [in] count       Number of parameters to retrieve.
+    /// @param [out] values     Array in which retrieved values are stored.
+    /// \returns status_t::ACK on success, error status otherwise.
+    ///
+    template<typename Handler>
+    uint8_t SysExConf::readRange(Handler& handler, uint16_t startIndex, uint16_t count, uint16_t* values)
+    {
+        if (_cacheEnabled)
+        {
+            [[maybe_unused]] auto lock  = lockState();
+            uint32_t              first = position(startIndex);
+            bool                  hit   = true;
+
+            for (uint16_t i = 0; i < count; i++)
+            {
+                if (!isCached(first + i))
+                {
+                    hit = false;
+                    break;
+                }
+            }
+
+            if (hit)
+            {
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    values[i] = _cache[first + i];
+                }
+
+                return static_cast<uint8_t>(status_t::ACK);
+            }
+        }
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        uint32_t generation = _cacheGeneration;
+#endif
+
+        uint8_t result = handler.getRange(session()._decodedMessage.block, session()._decodedMessage.section, startIndex, count, values);
+
+        if (result != static_cast<uint8_t>(status_t::ACK))
+        {
+            return result;
+        }
+
+        [[maybe_unused]] auto lock = lockState();
+
+        if (_writeBehindEnabled && _pendingWrites)
+        {
+            // deferred values aren't stored yet
+            for (uint16_t i = 0; i < count; i++)
+            {
+                if (isPending(position(startIndex) + i))
+                {
+                    values[i] = _pendingValues[position(startIndex) + i];
+                }
+            }
+        }
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        // values written meanwhile could be newer than the retrieved ones
+        if (generation != _cacheGeneration)
+        {
+            return result;
+        }
+#endif
+
+        if (_cacheEnabled)
+        {
+            cacheValues(position(startIndex), count, values);
+        }
+
+        return result;
+    }
+
+    ///
+    /// \brief Used to store multiple consecutive values in current section.
+    /// @param [in] handler     Object performing reading and writing of actual data.
+    /// @param [in] startIndex  Index of first parameter to store.
+    /// @param [in] count       Number of parameters to store.
+    /// @param [in] values      Array with values to store.
+    /// \returns status_t::ACK on success, error status otherwise.
+    ///
+    template<typename Handler>
+    uint8_t SysExConf::writeRange(Handler& handler, uint16_t startIndex, uint16_t count, const uint16_t* values)
+    {
+        uint8_t result   = static_cast<uint8_t>(status_t::ACK);
+        bool    deferred = false;
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        uint32_t generation = 0;
+#endif
+
+        {
+            [[maybe_unused]] auto lock = lockState();
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            generation = ++_cacheGeneration;
+#endif
+
+            deferred = _writeBehindEnabled;
+
+            if (deferred)
+            {
+                result = deferWrites(startIndex, count, values);
+            }
+        }
+
+        if (!deferred)
+        {
+            result = handler.setRange(session()._decodedMessage.block, session()._decodedMessage.section, startIndex, count, values);
+        }
+
+        [[maybe_unused]] auto lock = lockState();
+
+        if (result == static_cast<uint8_t>(status_t::ACK))
+        {
+            mergeStaged(startIndex, count, values);
+        }
+
+        if (_dirtyTrackingEnabled)
+        {
+            // on failure, some values could have been stored before it
+            markChanged(position(startIndex), count);
+        }
+
+        if (_cacheEnabled)
+        {
+#ifdef SYS_EX_CONF_THREAD_SAFE
+            // with other writes completed meanwhile, order in which values were stored is unknown
+            bool cache = (result == static_cast<uint8_t>(status_t::ACK)) && (generation == _cacheGeneration);
+#else
+            bool cache = result == static_cast<uint8_t>(status_t::ACK);
+#endif
+
+            if (cache)
+            {
+                cacheValues(position(startIndex), count, values);
+            }
+            else
+            {
+                // some values could have been stored before the failure
+                uncacheValues(position(startIndex), count);
+            }
+        }
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+        // values retrieved while the write was in progress could be older than the stored ones
+        _cacheGeneration++;
+#endif
+
+        return result;
+    }
 }    // namespace lib::sysexconf
 
 /// @}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+
+"""
+Compares two Google Benchmark JSON reports and flags regressions.
+
+Reports are produced with:
+    libsysexconf-bench --benchmark_out=<file> --benchmark_out_format=json
+
+When benchmarks were run with repetitions, median aggregate is compared.
+Exit code is 1 if any benchmark got slower than the threshold allows.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNIT_NS = {
+    "ns": 1.0,
+    "us": 1e3,
+    "ms": 1e6,
+    "s": 1e9,
+}
+
+
+def load(path, metric):
+    with open(path) as report:
+        benchmarks = json.load(report)["benchmarks"]
+
+    results = {}
+    medians = {}
+
+    for benchmark in benchmarks:
+        if benchmark.get("error_occurred"):
+            continue
+
+        name = benchmark.get("run_name", benchmark["name"])
+        time = benchmark[metric] * TIME_UNIT_NS[benchmark.get("time_unit", "ns")]
+
+        if benchmark.get("run_type") == "aggregate":
+            if benchmark.get("aggregate_name") == "median":
+                medians[name] = time
+        else:
+            # without aggregates, best of the repetitions is the least noisy
+            results[name] = min(time, results.get(name, time))
+
+    results.update(medians)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare benchmark report against baseline.")
+    parser.add_argument("baseline", help="baseline JSON report")
+    parser.add_argument("current", help="JSON report to check")
+    parser.add_argument("--threshold", type=float, default=5.0, help="allowed slowdown in percent (default: 5)")
+    parser.add_argument("--metric", choices=["cpu_time", "real_time"], default="cpu_time", help="time compared (default: cpu_time)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    current = load(args.current, args.metric)
+    regressions = 0
+    width = max([len(name) for name in baseline.keys() | current.keys()] + [len("Benchmark")])
+
+    print(f"{'Benchmark':<{width}} {'Baseline':>12} {'Current':>12} {'Change':>9}")
+
+    for name in sorted(baseline.keys() | current.keys()):
+        if name not in current:
+            print(f"{name:<{width}} {baseline[name]:>10.1f}ns {'-':>12} {'removed':>9}")
+            continue
+
+        if name not in baseline:
+            print(f"{name:<{width}} {'-':>12} {current[name]:>10.1f}ns {'new':>9}")
+            continue
+
+        change = ((current[name] - baseline[name]) / baseline[name]) * 100
+        marker = ""
+
+        if change > args.threshold:
+            marker = " REGRESSION"
+            regressions += 1
+
+        print(f"{name:<{width}} {baseline[name]:>10.1f}ns {current[name]:>10.1f}ns {change:>+8.1f}%{marker}")
+
+    if regressions:
+        print(f"\n{regressions} benchmark(s) slower than {args.threshold}% threshold")
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,655 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lib/sysexconf/client.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace lib::sysexconf;
+
+namespace
+{
+    ///
+    /// \brief Parts of single SET ALL request which haven't been completed yet.
+    ///
+    struct SetAllResult
+    {
+        ClientResult       result     = {};
+        size_t             remaining  = 0;
+        clientCompletion_t completion = nullptr;
+    };
+
+    ///
+    /// \brief Counts the values held by run-length coded bytes.
+    /// @param [in] input   Array with coded bytes.
+    /// @param [in] size    Number of coded bytes.
+    /// \returns Number of values, or 0 if the coded bytes are malformed.
+    ///
+    size_t rleCount(const uint8_t* input, size_t size)
+    {
+        size_t position = 0;
+        size_t count    = 0;
+
+        while (position < size)
+        {
+            uint8_t control = input[position++];
+            size_t  group   = (control & (RLE_RUN - 1)) + 1;
+
+            position += (control & RLE_RUN) ? 2 : (group * 2);
+            count += group;
+        }
+
+        return (position == size) ? count : 0;
+    }
+}    // namespace
+
+///
+/// \brief Drops all requests without completing them and restores default session settings.
+///
+void SysExConfClient::reset()
+{
+    _inFlight.clear();
+    _queue.clear();
+    _paramsPerMessage = PARAMS_PER_MESSAGE;
+    _compression      = compression_t::NONE;
+}
+
+///
+/// \brief Configures the number of requests sent without waiting for their responses.
+/// @param [in] depth   Number of requests in flight. 0 is treated as 1.
+///
+void SysExConfClient::setPipelineDepth(uint8_t depth)
+{
+    _pipelineDepth = std::max<uint8_t>(depth, 1);
+    sendQueued();
+}
+
+///
+/// \brief Passes message received from the device to the client.
+/// Once all frames of the oldest request in flight are received, its completion is called
+/// and next queued requests are sent.
+/// @param [in] array   Received message.
+/// @param [in] size    Message size.
+/// \returns True if the message is response to the oldest request in flight, false otherwise.
+///
+bool SysExConfClient::handleMessage(const uint8_t* array, uint16_t size)
+{
+    if (_inFlight.empty() || !matches(_inFlight.front(), array, size))
+    {
+        return false;
+    }
+
+    auto& pending = _inFlight.front();
+    auto  status  = static_cast<status_t>(array[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)]);
+
+    if (pending.allParts && (array[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] == 0x7E) && (status == status_t::ACK))
+    {
+        // final ACK frame, all parts have been received
+    }
+    else if ((status != status_t::ACK) && (status != status_t::REQUEST))
+    {
+        pending.result.status = status;
+        pending.result.values.clear();
+    }
+    else if (!appendValues(pending, array, size))
+    {
+        pending.result.status = status_t::ERROR_MESSAGE_LENGTH;
+        pending.result.values.clear();
+    }
+    else if (pending.allParts)
+    {
+        return true;
+    }
+
+    auto completed = std::move(pending);
+    _inFlight.pop_front();
+
+    if (completed.barrier && (completed.result.status == status_t::ACK))
+    {
+        negotiated(completed.frame);
+    }
+
+    if (completed.completion)
+    {
+        completed.completion(completed.result);
+    }
+
+    sendQueued();
+
+    return true;
+}
+
+///
+/// \brief Requests single parameter.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] index       Parameter index.
+/// @param [in] completion  Function called with the parameter value once the response is received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::get(uint8_t block, uint8_t section, uint16_t index, clientCompletion_t completion)
+{
+    return request(wish_t::GET, amount_t::SINGLE, block, section, 0, index, 0, std::move(completion));
+}
+
+///
+/// \brief Sets single parameter.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] index       Parameter index.
+/// @param [in] value       New value.
+/// @param [in] completion  Function called once the response is received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::set(uint8_t block, uint8_t section, uint16_t index, uint16_t value, clientCompletion_t completion)
+{
+    return request(wish_t::SET, amount_t::SINGLE, block, section, 0, index, value, std::move(completion));
+}
+
+///
+/// \brief Requests all parameters in section.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] completion  Function called with values of all parameters once all parts are received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::getAll(uint8_t block, uint8_t section, clientCompletion_t completion)
+{
+    return request(wish_t::GET, amount_t::ALL, block, section, 126, 0, 0, std::move(completion));
+}
+
+///
+/// \brief Requests parameters in section changed since last checkpoint.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] completion  Function called with index/value pairs once all parts are received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::getChanged(uint8_t block, uint8_t section, clientCompletion_t completion)
+{
+    return request(wish_t::GET, amount_t::CHANGED, block, section, 126, 0, 0, std::move(completion));
+}
+
+///
+/// \brief Requests backup of all parameters in section.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] completion  Function called with values of all parameters once all parts are received.
+///                         Values can be restored with setAll.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::backup(uint8_t block, uint8_t section, clientCompletion_t completion)
+{
+    return request(wish_t::BACKUP, amount_t::ALL, block, section, 126, 0, 0, std::move(completion));
+}
+
+///
+/// \brief Sets all parameters in section.
+/// Values are split into parts once the request is about to be sent, using the number of
+/// parameters per message and compression negotiated at that time.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] values      New values of all parameters in section.
+/// @param [in] completion  Function called once all parts are acknowledged, or with the first error reported for any of them.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::setAll(uint8_t block, uint8_t section, const std::vector<uint16_t>& values, clientCompletion_t completion)
+{
+    if (values.empty())
+    {
+        return false;
+    }
+
+    Pending pending;
+
+    pending.frame      = standard(wish_t::SET, amount_t::ALL, block, section, 0);
+    pending.values     = values;
+    pending.completion = std::move(completion);
+
+    return enqueue(std::move(pending));
+}
+
+///
+/// \brief Queues standard request.
+/// SET ALL requests need values, use setAll for them. Part 127 isn't supported since the
+/// end of its responses can't be detected, part 126 is used instead.
+/// @param [in] wish        Request wish.
+/// @param [in] amount      Request amount.
+/// @param [in] block       Block index.
+/// @param [in] section     Section index.
+/// @param [in] part        Message part.
+/// @param [in] index       Parameter index.
+/// @param [in] value       New value.
+/// @param [in] completion  Function called once the response is received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::request(wish_t wish, amount_t amount, uint8_t block, uint8_t section, uint8_t part, uint16_t index, uint16_t value, clientCompletion_t completion)
+{
+    if (((wish == wish_t::SET) && (amount == amount_t::ALL)) || (part == 127))
+    {
+        return false;
+    }
+
+    Pending pending;
+
+    pending.frame      = standard(wish, amount, block, section, part);
+    pending.allParts   = part == 126;
+    pending.completion = std::move(completion);
+
+    auto splitIndex = Split14Bit(index);
+    auto splitValue = Split14Bit(value);
+
+    pending.frame.push_back(splitIndex.high());
+    pending.frame.push_back(splitIndex.low());
+    pending.frame.push_back(splitValue.high());
+    pending.frame.push_back(splitValue.low());
+    pending.frame.push_back(0xF7);
+
+    return enqueue(std::move(pending));
+}
+
+///
+/// \brief Queues special request without value.
+/// Dump and window acknowledgement aren't supported since their responses aren't matched to single request.
+/// @param [in] request     Special request.
+/// @param [in] completion  Function called with the values in response once it's received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::special(specialRequest_t request, clientCompletion_t completion)
+{
+    if ((request == specialRequest_t::DUMP) || (request == specialRequest_t::WINDOW_ACK))
+    {
+        return false;
+    }
+
+    Pending pending;
+
+    pending.frame      = header(0, static_cast<uint8_t>(request));
+    pending.barrier    = (request == specialRequest_t::CONN_OPEN) || (request == specialRequest_t::CONN_CLOSE);
+    pending.completion = std::move(completion);
+
+    pending.frame.push_back(0xF7);
+
+    return enqueue(std::move(pending));
+}
+
+///
+/// \brief Queues special request with value.
+/// Flow control window can't be configured since the client doesn't acknowledge windows.
+/// @param [in] request     Special request.
+/// @param [in] value       Value sent in request.
+/// @param [in] completion  Function called once the response is received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::special(specialRequest_t request, uint16_t value, clientCompletion_t completion)
+{
+    if ((request != specialRequest_t::PARAMS_PER_MESSAGE) && (request != specialRequest_t::COMPRESSION) && (request != specialRequest_t::STATS))
+    {
+        return false;
+    }
+
+    Pending pending;
+
+    pending.frame      = header(0, static_cast<uint8_t>(request));
+    pending.barrier    = request != specialRequest_t::STATS;
+    pending.completion = std::move(completion);
+
+    auto split = Split14Bit(value);
+
+    pending.frame.push_back(split.high());
+    pending.frame.push_back(split.low());
+    pending.frame.push_back(0xF7);
+
+    return enqueue(std::move(pending));
+}
+
+///
+/// \brief Queues custom request.
+/// @param [in] requestId   Custom request ID.
+/// @param [in] completion  Function called with the values in response once it's received.
+/// \returns True if the request is queued, false otherwise.
+///
+bool SysExConfClient::custom(uint8_t requestId, clientCompletion_t completion)
+{
+    if (requestId < CUSTOM_REQUEST_ID_MIN)
+    {
+        return false;
+    }
+
+    Pending pending;
+
+    pending.frame      = header(0, requestId);
+    pending.completion = std::move(completion);
+
+    pending.frame.push_back(0xF7);
+
+    return enqueue(std::move(pending));
+}
+
+///
+/// \brief Retrieves the number of requests sent to the device and not yet completed.
+///
+size_t SysExConfClient::inFlight() const
+{
+    return _inFlight.size();
+}
+
+///
+/// \brief Retrieves the number of requests waiting to be sent.
+///
+size_t SysExConfClient::queued() const
+{
+    return _queue.size();
+}
+
+///
+/// \brief Retrieves the number of parameters per message negotiated with the device.
+///
+uint16_t SysExConfClient::paramsPerMessage() const
+{
+    return _paramsPerMessage;
+}
+
+///
+/// \brief Retrieves the compression negotiated with the device.
+///
+compression_t SysExConfClient::compression() const
+{
+    return _compression;
+}
+
+///
+/// \brief Builds the part of request frame shared by all requests.
+/// @param [in] part    Message part.
+/// @param [in] wish    Wish or special request ID.
+/// \returns Frame with start byte, manufacturer ID, status, part and wish.
+///
+std::vector<uint8_t> SysExConfClient::header(uint8_t part, uint8_t wish) const
+{
+    return {
+        0xF0,
+        _manufacturerId.id1,
+        _manufacturerId.id2,
+        _manufacturerId.id3,
+        static_cast<uint8_t>(status_t::REQUEST),
+        part,
+        wish,
+    };
+}
+
+///
+/// \brief Builds standard request frame up to the parameter index.
+/// \returns Frame with header, amount, block and section.
+///
+std::vector<uint8_t> SysExConfClient::standard(wish_t wish, amount_t amount, uint8_t block, uint8_t section, uint8_t part) const
+{
+    auto frame = header(part, static_cast<uint8_t>(wish));
+
+    frame.push_back(static_cast<uint8_t>(amount));
+    frame.push_back(block);
+    frame.push_back(section);
+
+    return frame;
+}
+
+///
+/// \brief Queues the request and sends it if there is room in the pipeline.
+/// \returns Always true.
+///
+bool SysExConfClient::enqueue(Pending&& pending)
+{
+    _queue.push_back(std::move(pending));
+    sendQueued();
+
+    return true;
+}
+
+///
+/// \brief Sends queued requests until the pipeline is full or request changing the session is in flight.
+/// Requests which can't be sent are completed with status_t::ERROR_CONNECTION.
+///
+void SysExConfClient::sendQueued()
+{
+    while (!_queue.empty() && (_inFlight.size() < _pipelineDepth) && !barrierInFlight())
+    {
+        if (!_queue.front().values.empty())
+        {
+            splitSetAll();
+            continue;
+        }
+
+        _inFlight.push_back(std::move(_queue.front()));
+        _queue.pop_front();
+
+        // response can be received before send returns, so the frame can't be referenced
+        auto frame = _inFlight.back().frame;
+
+        if (!_transport.send(frame.data(), frame.size()))
+        {
+            auto failed = std::move(_inFlight.back());
+            _inFlight.pop_back();
+
+            failed.result.status = status_t::ERROR_CONNECTION;
+
+            if (failed.completion)
+            {
+                failed.completion(failed.result);
+            }
+        }
+    }
+}
+
+///
+/// \brief Replaces SET ALL request at the front of the queue with a request for each of its parts.
+/// Request is completed with status_t::ERROR_PART without being sent if values don't fit in MAX_PARTS parts.
+///
+void SysExConfClient::splitSetAll()
+{
+    auto setAll    = std::move(_queue.front());
+    auto aggregate = std::make_shared<SetAllResult>();
+    auto parts     = (setAll.values.size() + _paramsPerMessage - 1) / _paramsPerMessage;
+
+    _queue.pop_front();
+
+    // part byte can't address more parts
+    if (parts > MAX_PARTS)
+    {
+        setAll.result.status = status_t::ERROR_PART;
+
+        if (setAll.completion)
+        {
+            setAll.completion(setAll.result);
+        }
+
+        return;
+    }
+
+    aggregate->remaining  = parts;
+    aggregate->completion = std::move(setAll.completion);
+
+    for (size_t part = parts; part--;)
+    {
+        auto    first = part * _paramsPerMessage;
+        auto    count = std::min<size_t>(_paramsPerMessage, setAll.values.size() - first);
+        Pending pending;
+
+        pending.frame                                               = setAll.frame;
+        pending.frame[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = static_cast<uint8_t>(part);
+
+        auto size = pending.frame.size();
+
+        if (_compression == compression_t::RLE)
+        {
+            pending.frame.resize(size + RLE_MAX_SIZE(count));
+            pending.frame.resize(size + encodeRle(&setAll.values[first], &pending.frame[size], count));
+        }
+        else
+        {
+            pending.frame.resize(size + (count * BYTES_PER_VALUE));
+            encode14Bit(&setAll.values[first], &pending.frame[size], count);
+        }
+
+        pending.frame.push_back(0xF7);
+
+        pending.completion = [aggregate](const ClientResult& result)
+        {
+            if ((result.status != status_t::ACK) && (aggregate->result.status == status_t::ACK))
+            {
+                aggregate->result.status = result.status;
+            }
+
+            if (!--aggregate->remaining && aggregate->completion)
+            {
+                aggregate->completion(aggregate->result);
+            }
+        };
+
+        _queue.push_front(std::move(pending));
+    }
+}
+
+///
+/// \brief Checks whether request changing the session is in flight.
+///
+bool SysExConfClient::barrierInFlight() const
+{
+    // nothing is sent after such request, so it can only be the last one
+    return !_inFlight.empty() && _inFlight.back().barrier;
+}
+
+///
+/// \brief Checks whether the message is response to the request.
+/// @param [in] pending Request to which the message is matched.
+/// @param [in] array   Received message.
+/// @param [in] size    Message size.
+/// \returns True if the message is response to the request, false otherwise.
+///
+bool SysExConfClient::matches(const Pending& pending, const uint8_t* array, uint16_t size) const
+{
+    if ((size < SPECIAL_REQ_MSG_SIZE) || (array[0] != 0xF0) || (array[size - 1] != 0xF7))
+    {
+        return false;
+    }
+
+    if ((array[static_cast<uint8_t>(byteOrder_t::ID_BYTE_1)] != _manufacturerId.id1) ||
+        (array[static_cast<uint8_t>(byteOrder_t::ID_BYTE_2)] != _manufacturerId.id2) ||
+        (array[static_cast<uint8_t>(byteOrder_t::ID_BYTE_3)] != _manufacturerId.id3))
+    {
+        return false;
+    }
+
+    auto& frame  = pending.frame;
+    auto  status = static_cast<status_t>(array[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)]);
+    auto  wish   = array[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)];
+
+    if (frame.size() <= SPECIAL_REQ_VALUE_MSG_SIZE)
+    {
+        // special and custom requests
+        return (status != status_t::REQUEST) && (wish == frame[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
+    }
+
+    if ((size <= static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)) ||
+        (array[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)] != frame[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)]) ||
+        (array[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)] != frame[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)]) ||
+        (array[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] != frame[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)]))
+    {
+        return false;
+    }
+
+    if (frame[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] == static_cast<uint8_t>(wish_t::BACKUP))
+    {
+        // backup responses are requests which restore the values, final ACK is sent as for get request
+        return (wish == static_cast<uint8_t>(wish_t::BACKUP)) || (wish == static_cast<uint8_t>(wish_t::SET)) || (wish == static_cast<uint8_t>(wish_t::GET));
+    }
+
+    return (status != status_t::REQUEST) && (wish == frame[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
+}
+
+///
+/// \brief Decodes values appended by the device to the request and stores them in the result.
+/// @param [in] pending Request to which the message is response.
+/// @param [in] array   Received message.
+/// @param [in] size    Message size.
+/// \returns True on success, false if the values can't be decoded.
+///
+bool SysExConfClient::appendValues(Pending& pending, const uint8_t* array, uint16_t size) const
+{
+    bool   backup = static_cast<status_t>(array[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)]) == status_t::REQUEST;
+    size_t offset = backup ? static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) : pending.frame.size() - 1;
+
+    if (static_cast<size_t>(size - 1) < offset)
+    {
+        return false;
+    }
+
+    const uint8_t* payload = &array[offset];
+    size_t         length  = size - 1 - offset;
+    auto&          values  = pending.result.values;
+    auto           first   = values.size();
+
+    if ((_compression == compression_t::RLE) &&
+        (pending.frame.size() > SPECIAL_REQ_VALUE_MSG_SIZE) &&
+        (pending.frame[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)] == static_cast<uint8_t>(amount_t::ALL)))
+    {
+        auto count = rleCount(payload, length);
+
+        values.resize(first + count);
+        return decodeRle(payload, length, values.data() + first, count);
+    }
+
+    if (length % BYTES_PER_VALUE)
+    {
+        return false;
+    }
+
+    values.resize(first + (length / BYTES_PER_VALUE));
+    decode14Bit(payload, values.data() + first, length / BYTES_PER_VALUE);
+
+    return true;
+}
+
+///
+/// \brief Applies session settings changed by acknowledged request.
+/// @param [in] frame   Acknowledged request.
+///
+void SysExConfClient::negotiated(const std::vector<uint8_t>& frame)
+{
+    auto request = static_cast<specialRequest_t>(frame[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
+
+    if ((request == specialRequest_t::CONN_OPEN) || (request == specialRequest_t::CONN_CLOSE))
+    {
+        _paramsPerMessage = PARAMS_PER_MESSAGE;
+        _compression      = compression_t::NONE;
+        return;
+    }
+
+    auto merge = Merge14Bit(frame[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], frame[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]);
+
+    if (request == specialRequest_t::PARAMS_PER_MESSAGE)
+    {
+        _paramsPerMessage = merge.value();
+    }
+    else if (request == specialRequest_t::COMPRESSION)
+    {
+        _compression = static_cast<compression_t>(merge.value());
+    }
+}
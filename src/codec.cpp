@@ -0,0 +1,253 @@
+/*
+    Copyright 2017-2022 Igor Petrovic
+
+    Permission is hereby granted, free of charge, to any person obtaining
+    a copy of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+    OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "lib/sysexconf/codec.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SYS_EX_CONF_CODEC_AVX2
+#define SYS_EX_CONF_CODEC_SSE2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SYS_EX_CONF_CODEC_SSE2
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define SYS_EX_CONF_CODEC_NEON
+#endif
+
+// Vector kernels treat each encoded byte pair as single little-endian 16-bit lane:
+// high byte of the pair is in the lower half of the lane, low byte in the upper one.
+
+void lib::sysexconf::encode14BitScalar(const uint16_t* values, uint8_t* output, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint16_t value = values[i];
+
+        output[(i * 2)]     = (value >> 7) & 0x7F;
+        output[(i * 2) + 1] = value & 0x7F;
+    }
+}
+
+void lib::sysexconf::decode14BitScalar(const uint8_t* input, uint16_t* values, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = (static_cast<uint16_t>(input[(i * 2)]) << 7) | (input[(i * 2) + 1] & 0x7F);
+    }
+}
+
+void lib::sysexconf::encode14Bit(const uint16_t* values, uint8_t* output, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SYS_EX_CONF_CODEC_AVX2
+    const __m256i MASK_256 = _mm256_set1_epi16(0x7F);
+
+    for (; (i + 16) <= count; i += 16)
+    {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&values[i]));
+        __m256i high  = _mm256_and_si256(_mm256_srli_epi16(value, 7), MASK_256);
+        __m256i low   = _mm256_slli_epi16(_mm256_and_si256(value, MASK_256), 8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&output[i * 2]), _mm256_or_si256(high, low));
+    }
+#endif
+
+#ifdef SYS_EX_CONF_CODEC_SSE2
+    const __m128i MASK_128 = _mm_set1_epi16(0x7F);
+
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&values[i]));
+        __m128i high  = _mm_and_si128(_mm_srli_epi16(value, 7), MASK_128);
+        __m128i low   = _mm_slli_epi16(_mm_and_si128(value, MASK_128), 8);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&output[i * 2]), _mm_or_si128(high, low));
+    }
+#endif
+
+#ifdef SYS_EX_CONF_CODEC_NEON
+    const uint16x8_t MASK = vdupq_n_u16(0x7F);
+
+    for (; (i + 8) <= count; i += 8)
+    {
+        uint16x8_t value = vld1q_u16(&values[i]);
+        uint16x8_t high  = vandq_u16(vshrq_n_u16(value, 7), MASK);
+        uint16x8_t low   = vshlq_n_u16(vandq_u16(value, MASK), 8);
+
+        vst1q_u8(&output[i * 2], vreinterpretq_u8_u16(vorrq_u16(high, low)));
+    }
+#endif
+
+    encode14BitScalar(&values[i], &output[i * 2], count - i);
+}
+
+void lib::sysexconf::decode14Bit(const uint8_t* input, uint16_t* values, size_t count)
+{
+    size_t i = 0;
+
+#ifdef SYS_EX_CONF_CODEC_AVX2
+    const __m256i HIGH_MASK_256 = _mm256_set1_epi16(0xFF);
+    const __m256i LOW_MASK_256  = _mm256_set1_epi16(0x7F);
+
+    for (; (i + 16) <= count; i += 16)
+    {
+        __m256i pair  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&input[i * 2]));
+        __m256i high  = _mm256_slli_epi16(_mm256_and_si256(pair, HIGH_MASK_256), 7);
+        __m256i low   = _mm256_and_si256(_mm256_srli_epi16(pair, 8), LOW_MASK_256);
+        __m256i value = _mm256_or_si256(high, low);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&values[i]), value);
+    }
+#endif
+
+#ifdef SYS_EX_CONF_CODEC_SSE2
+    const __m128i HIGH_MASK_128 = _mm_set1_epi16(0xFF);
+    const __m128i LOW_MASK_128  = _mm_set1_epi16(0x7F);
+
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m128i pair  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&input[i * 2]));
+        __m128i high  = _mm_slli_epi16(_mm_and_si128(pair, HIGH_MASK_128), 7);
+        __m128i low   = _mm_and_si128(_mm_srli_epi16(pair, 8), LOW_MASK_128);
+        __m128i value = _mm_or_si128(high, low);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&values[i]), value);
+    }
+#endif
+
+#ifdef SYS_EX_CONF_CODEC_NEON
+    const uint16x8_t HIGH_MASK = vdupq_n_u16(0xFF);
+    const uint16x8_t LOW_MASK  = vdupq_n_u16(0x7F);
+
+    for (; (i + 8) <= count; i += 8)
+    {
+        uint16x8_t pair  = vreinterpretq_u16_u8(vld1q_u8(&input[i * 2]));
+        uint16x8_t high  = vshlq_n_u16(vandq_u16(pair, HIGH_MASK), 7);
+        uint16x8_t low   = vandq_u16(vshrq_n_u16(pair, 8), LOW_MASK);
+        uint16x8_t value = vorrq_u16(high, low);
+
+        vst1q_u16(&values[i], value);
+    }
+#endif
+
+    decode14BitScalar(&input[i * 2], &values[i], count - i);
+}
+
+const char* lib::sysexconf::codecImplementation()
+{
+#if defined(SYS_EX_CONF_CODEC_AVX2)
+    return "avx2";
+#elif defined(SYS_EX_CONF_CODEC_SSE2)
+    return "sse2";
+#elif defined(SYS_EX_CONF_CODEC_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+size_t lib::sysexconf::encodeRle(const uint16_t* values, uint8_t* output, size_t count)
+{
+    // runs shorter than this cost the same or more than literal values
+    constexpr size_t MIN_RUN = 3;
+
+    size_t size    = 0;
+    size_t literal = 0;    // position of control byte of current literal group
+    size_t group   = 0;    // number of values in current literal group
+    size_t i       = 0;
+
+    while (i < count)
+    {
+        size_t run = 1;
+
+        while (((i + run) < count) && (run < RLE_MAX_GROUP) && (values[i + run] == values[i]))
+        {
+            run++;
+        }
+
+        if (run >= MIN_RUN)
+        {
+            group = 0;
+
+            output[size++] = RLE_RUN | (run - 1);
+            encode14BitScalar(&values[i], &output[size], 1);
+            size += 2;
+            i += run;
+            continue;
+        }
+
+        if (!group)
+        {
+            literal = size++;
+        }
+
+        output[literal] = group;
+        encode14BitScalar(&values[i], &output[size], 1);
+        size += 2;
+        i++;
+
+        if (++group == RLE_MAX_GROUP)
+        {
+            group = 0;
+        }
+    }
+
+    return size;
+}
+
+bool lib::sysexconf::decodeRle(const uint8_t* input, size_t size, uint16_t* values, size_t count)
+{
+    size_t position = 0;
+    size_t decoded  = 0;
+
+    while (position < size)
+    {
+        uint8_t control = input[position++];
+        size_t  group   = (control & (RLE_RUN - 1)) + 1;
+        size_t  bytes   = (control & RLE_RUN) ? 2 : (group * 2);
+
+        if ((control & 0x80) || ((decoded + group) > count) || ((position + bytes) > size))
+        {
+            return false;
+        }
+
+        if (control & RLE_RUN)
+        {
+            decode14BitScalar(&input[position], &values[decoded], 1);
+
+            for (size_t i = 1; i < group; i++)
+            {
+                values[decoded + i] = values[decoded];
+            }
+        }
+        else
+        {
+            decode14Bit(&input[position], &values[decoded], group);
+        }
+
+        position += bytes;
+        decoded += group;
+    }
+
+    return decoded == count;
+}
@@ -21,7 +21,8 @@
 
 #include "lib/sysexconf/sysexconf.h"
 
-#define LAYOUT_ACCESS (*_layout)
+#include <algorithm>
+#include <cstring>
 
 using namespace lib::sysexconf;
 
@@ -30,51 +31,184 @@ using namespace lib::sysexconf;
 ///
 void SysExConf::reset()
 {
-    _sysExEnabled               = false;
+    reset(_defaultSession);
     _userErrorIgnoreModeEnabled = false;
-    _decodedMessage             = {};
-    _responseCounter            = 0;
-    LAYOUT_ACCESS.clear();
+    _sections                   = nullptr;
+    _blocks                     = nullptr;
+    _blockCount                 = 0;
+    _sectionTable.clear();
+    _blockTable.clear();
     _sysExCustomRequest.clear();
+    _customRequestTable.fill(NO_CUSTOM_REQUEST);
+    setResponseRing(nullptr, 0);
+    setSegmentedResponses(false);
+    setCache(false);
+    setDirtyTracking(false);
+
+    // deferred writes are discarded on reset
+    _writeBehindEnabled  = false;
+    _writeBehindIdleTime = 0;
+    _journalSize         = 0;
+    _journalEntries      = 0;
+    resizeWriteBehind();
+    setStagedWrites(false);
+}
+
+///
+/// \brief Resets state of single session to default values, closing the connection on its port.
+/// @param [in] session Session to reset.
+///
+void SysExConf::reset(Session& session)
+{
+    session._sysExEnabled     = false;
+    session._paramsPerMessage = PARAMS_PER_MESSAGE;
+    session._compression      = compression_t::NONE;
+    session._windowSize       = 0;
+    session._windowCredits    = 0;
+    session._transferResuming = false;
+    session._transfer         = {};
+    session._decodedMessage   = {};
+    session._responseCounter    = 0;
+    session._responseHeaderSize = 0;
+    session._streamState        = Session::streamState_t::IDLE;
+    session._streamCounter    = 0;
+
+    discardStaged(session);
 }
 
 ///
 /// Configures user specifed configuration layout and initializes data to their default values.
+/// Layout is flattened into internal tables so it isn't referenced after this call.
 /// @param [in] sections     Vector containing all sections.
-/// \returns True on success, false otherwise.
+/// \returns True on success, false otherwise (empty layout or layout which can't be addressed by the protocol).
 ///
 bool SysExConf::setLayout(std::vector<Block>& layout)
 {
-    _sysExEnabled = false;
+    session()._sysExEnabled = false;
+    _sections               = nullptr;
+    _blocks                 = nullptr;
+    _blockCount             = 0;
+    _sectionTable.clear();
+    _blockTable.clear();
+    resizeCache();
+    resizeDirtyTracking();
+    resizeWriteBehind();
+    clearStaging();
+
+    if (!layout.size() || (layout.size() > MAX_BLOCKS))
+    {
+        return false;
+    }
+
+    uint32_t offset = 0;
 
-    if (layout.size())
+    _blockTable.reserve(layout.size());
+
+    for (size_t block = 0; block < layout.size(); block++)
     {
-        _layout = &layout;
-        return true;
+        if (layout[block]._sections.size() > MAX_SECTIONS)
+        {
+            _sectionTable.clear();
+            _blockTable.clear();
+            return false;
+        }
+
+        BlockDescriptor blockDescriptor;
+        blockDescriptor.firstSection = _sectionTable.size();
+        blockDescriptor.sections     = layout[block]._sections.size();
+        _blockTable.push_back(blockDescriptor);
+
+        for (size_t section = 0; section < layout[block]._sections.size(); section++)
+        {
+            auto descriptor   = layout[block]._sections[section].descriptor();
+            descriptor.offset = offset;
+
+            // checked before the number of parts is narrowed to fit the descriptor
+            if ((descriptor.numberOfParameters > MAX_PARAMETERS) ||
+                (descriptor.newValueMin > MAX_VALUE) ||
+                (descriptor.newValueMax > MAX_VALUE))
+            {
+                _sectionTable.clear();
+                _blockTable.clear();
+                return false;
+            }
+
+            offset += descriptor.numberOfParameters;
+            _sectionTable.push_back(descriptor);
+        }
     }
 
-    return false;
+    _sections   = _sectionTable.data();
+    _blocks     = _blockTable.data();
+    _blockCount = _blockTable.size();
+
+    resizeCache();
+    resizeDirtyTracking();
+    resizeWriteBehind();
+    clearStaging();
+
+    return true;
+}
+
+///
+/// \brief Configures layout precomputed at compile time.
+/// @param [in] sections        Table with data for all sections in layout.
+/// @param [in] blocks          Table with data for all blocks in layout.
+/// @param [in] numberOfBlocks  Total number of blocks in layout.
+///
+void SysExConf::setLayout(const SectionDescriptor* sections, const BlockDescriptor* blocks, uint8_t numberOfBlocks)
+{
+    session()._sysExEnabled = false;
+    _sections               = sections;
+    _blocks                 = blocks;
+    _blockCount             = numberOfBlocks;
+    _sectionTable.clear();
+    _blockTable.clear();
+    resizeCache();
+    resizeDirtyTracking();
+    resizeWriteBehind();
+    clearStaging();
 }
 
 ///
 /// \brief Configures custom requests stored in external structure.
+/// Requests are indexed by their ID so that they can be found in constant time.
+/// IDs below CUSTOM_REQUEST_ID_MIN are used by special requests and are rejected,
+/// as are more than 255 requests.
 /// @param [in] customRequests          Pointer to structure containing custom requests.
 /// @param [in] numberOfCustomRequests  Total number of requests stored in specified structure.
 /// \returns True on success, false otherwise.
 ///
 bool SysExConf::setupCustomRequests(std::vector<CustomRequest>& customRequests)
 {
+    // positions are stored in single byte, with largest value marking unused ID
+    if (customRequests.size() > NO_CUSTOM_REQUEST)
+    {
+        return false;
+    }
+
     if (customRequests.size())
     {
         _sysExCustomRequest = std::move(customRequests);
+        _customRequestTable.fill(NO_CUSTOM_REQUEST);
 
         for (size_t i = 0; i < _sysExCustomRequest.size(); i++)
         {
-            if (_sysExCustomRequest[i].requestId < static_cast<uint8_t>(specialRequest_t::AMOUNT))
+            auto requestId = _sysExCustomRequest[i].requestId;
+
+            if (requestId < CUSTOM_REQUEST_ID_MIN)
             {
                 _sysExCustomRequest = {};
+                _customRequestTable.fill(NO_CUSTOM_REQUEST);
                 return false;    // id already used internally
             }
+
+            // request IDs are transferred in single 7-bit byte, larger ones can't be requested
+            // if the same ID is specified more than once, first one is used
+            if ((requestId < _customRequestTable.size()) && (_customRequestTable[requestId] == NO_CUSTOM_REQUEST))
+            {
+                _customRequestTable[requestId] = i;
+            }
         }
 
         return true;
@@ -89,9 +223,45 @@ bool SysExConf::setupCustomRequests(std::vector<CustomRequest>& customRequests)
 ///
 bool SysExConf::isConfigurationEnabled()
 {
-    return _sysExEnabled;
+    return session()._sysExEnabled;
+}
+
+///
+/// \brief Retrieves the port of the session whose request is currently being handled.
+/// Meant to be called from DataHandler while sending responses so that they can be
+/// routed back to the port on which the request has been received.
+/// \returns Port of the active session, or port of the default session outside of request handling.
+///
+uint8_t SysExConf::port() const
+{
+    return session()._port;
+}
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+SysExConf::SessionScope::SessionScope(SysExConf& engine, Session& session)
+    : _previous(_activeSession)
+{
+    _activeSession = { &engine, &session };
 }
 
+SysExConf::SessionScope::~SessionScope()
+{
+    _activeSession = _previous;
+}
+#else
+SysExConf::SessionScope::SessionScope(SysExConf& engine, Session& session)
+    : _engine(engine)
+    , _previous(engine._session)
+{
+    _engine._session = &session;
+}
+
+SysExConf::SessionScope::~SessionScope()
+{
+    _engine._session = _previous;
+}
+#endif
+
 ///
 /// \brief Enables or disables user error ignore mode.
 /// When user error ignore mode is active, protocol will always return ACK
@@ -103,6 +273,15 @@ void SysExConf::setUserErrorIgnoreMode(bool state)
     _userErrorIgnoreModeEnabled = state;
 }
 
+///
+/// \brief Checks whether the user error ignore mode is enabled or not.
+/// \returns True if enabled, false otherwise.
+///
+bool SysExConf::isUserErrorIgnoreModeEnabled() const
+{
+    return _userErrorIgnoreModeEnabled;
+}
+
 ///
 /// \brief Handles incoming SysEx message.
 /// @param [in] array   SysEx array.
@@ -110,50 +289,70 @@ void SysExConf::setUserErrorIgnoreMode(bool state)
 ///
 void SysExConf::handleMessage(const uint8_t* array, uint16_t size)
 {
-    if (!LAYOUT_ACCESS.size())
+    if (!blocks())
     {
         return;
     }
 
-    if (size < SPECIAL_REQ_MSG_SIZE)
-    {
-        return;    // ignore small messages
-    }
-
-    if (array[0] != 0xF0)
+    // ignore small, malformed and oversized messages
+    if ((size < SPECIAL_REQ_MSG_SIZE) || (array[0] != 0xF0) || (array[size - 1] != 0xF7) || (size > MAX_MESSAGE_SIZE))
     {
+#ifdef SYS_EX_CONF_STATS
+        countStat(offsetof(Stats, droppedFrames));
+#endif
         return;
     }
 
-    if (array[size - 1] != 0xF7)
+    // framing and ID are validated directly on the incoming buffer so that
+    // frames meant for other devices are dropped before anything is copied
+    if (!checkManufacturerId(array))
     {
-        return;
+#ifdef SYS_EX_CONF_STATS
+        countStat(offsetof(Stats, foreignFrames));
+#endif
+        return;    // don't send response to wrong ID
     }
 
-    if (size > MAX_MESSAGE_SIZE)
-    {
-        return;
-    }
+#ifdef SYS_EX_CONF_STATS
+    // request can be overwritten while the response is built
+    uint32_t statsStart   = statsTime();
+    uint8_t  statsWish    = array[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)];
+    uint8_t  statsAmount  = array[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)];
+    bool     statsSpecial = (size == SPECIAL_REQ_MSG_SIZE) || (size == SPECIAL_REQ_VALUE_MSG_SIZE);
+
+    countStat(offsetof(Stats, frames));
+    session()._statsStatus = static_cast<uint8_t>(status_t::ACK);
+#endif
 
     resetDecodedMessage();
 
-    // copy entire incoming message to internal buffer
-    for (uint16_t i = 0; i < size; i++)
+    // message is meant for this device and will always be answered:
+    // response is built on top of the request
+    // when the message was assembled by the stream parser it is already in place
+    if (array != session()._responseArray)
     {
-        _responseArray[i] = array[i];
+        abortStream();
+
+        for (uint16_t i = 0; i < size; i++)
+        {
+            session()._responseArray[i] = array[i];
+        }
     }
 
     // for now, set the response counter to last position in request
-    _responseCounter = size - 1;
+    session()._responseCounter    = size - 1;
+    session()._responseHeaderSize = 0;
+
+    bool sendResponseVar = true;
 
-    if (!checkManufacturerId())
+    // every request except window acknowledgement cancels paused transfer
+    if (((size != SPECIAL_REQ_MSG_SIZE) && (size != SPECIAL_REQ_VALUE_MSG_SIZE)) ||
+        (array[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] != static_cast<uint8_t>(specialRequest_t::WINDOW_ACK)))
     {
-        return;    // don't send response to wrong ID
+        resetWindow();
     }
 
-    bool sendResponseVar = true;
-
-    if (!checkStatus())
+    if (!checkStatus(array))
     {
         setStatus(status_t::ERROR_STATUS);
     }
@@ -161,13 +360,26 @@ void SysExConf::handleMessage(const uint8_t* array, uint16_t size)
     {
         if (decode(array, size))
         {
-            if (size == SPECIAL_REQ_MSG_SIZE)
+            if ((size == SPECIAL_REQ_MSG_SIZE) || (size == SPECIAL_REQ_VALUE_MSG_SIZE))
             {
-                processSpecialRequest();
+                if (array[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] == static_cast<uint8_t>(specialRequest_t::DUMP))
+                {
+                    // responses for all sections are sent while the request is processed
+                    sendResponseVar = !processDumpRequest(array, size);
+                }
+                else if (array[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] == static_cast<uint8_t>(specialRequest_t::WINDOW_ACK))
+                {
+                    // responses of resumed transfer are sent while the request is processed
+                    sendResponseVar = !processWindowAck(array, size);
+                }
+                else
+                {
+                    processSpecialRequest(array, size);
+                }
             }
             else
             {
-                if (processStandardRequest(size))
+                if (handleStandardRequest(array, size))
                 {
                     // in this case, processStandardRequest will internally call
                     // sendResponse function, which means it's not necessary to call
@@ -192,6 +404,246 @@ void SysExConf::handleMessage(const uint8_t* array, uint16_t size)
     {
         sendResponse(false);
     }
+
+    // error could have been reported while the response was sent as segments
+    session()._responseHeaderSize = 0;
+
+#ifdef SYS_EX_CONF_STATS
+    recordRequest(statsWish, statsAmount, statsSpecial, statsStart);
+#endif
+}
+
+///
+/// \brief Feeds single byte of incoming MIDI stream to the protocol.
+/// Bytes are assembled directly in the internal buffer and the message is
+/// handled as soon as 0xF7 is received. Header is verified while the message
+/// is still being received so that messages meant for other devices are
+/// skipped without being stored.
+/// @param [in] data    Received byte.
+///
+void SysExConf::feedByte(uint8_t data)
+{
+    if (data >= 0xF8)
+    {
+        // system real time messages can appear anywhere, including inside SysEx
+        return;
+    }
+
+    if (data == 0xF0)
+    {
+        // start of new message, discard anything received so far
+        session()._streamCounter                             = 0;
+        session()._responseArray[session()._streamCounter++] = data;
+        session()._streamState                               = Session::streamState_t::HEADER;
+        return;
+    }
+
+    switch (session()._streamState)
+    {
+    case Session::streamState_t::HEADER:
+    case Session::streamState_t::BODY:
+    {
+        if (data == 0xF7)
+        {
+            session()._responseArray[session()._streamCounter++] = data;
+            session()._streamState                               = Session::streamState_t::IDLE;
+
+            handleMessage(session()._responseArray, session()._streamCounter);
+            return;
+        }
+
+        if (data & 0x80)
+        {
+            // any other status byte terminates SysEx message
+            session()._streamState = Session::streamState_t::IDLE;
+
+#ifdef SYS_EX_CONF_STATS
+            countStat(offsetof(Stats, droppedFrames));
+#endif
+            return;
+        }
+
+        if (session()._streamCounter >= (MAX_MESSAGE_SIZE - 1))
+        {
+            // no space left for 0xF7, message is too large for this protocol
+            session()._streamState = Session::streamState_t::DISCARD;
+
+#ifdef SYS_EX_CONF_STATS
+            countStat(offsetof(Stats, droppedFrames));
+#endif
+            return;
+        }
+
+        session()._responseArray[session()._streamCounter++] = data;
+
+        if (session()._streamState == Session::streamState_t::HEADER)
+        {
+            if (session()._streamCounter > static_cast<uint8_t>(byteOrder_t::ID_BYTE_3))
+            {
+                if (checkManufacturerId(session()._responseArray))
+                {
+                    session()._streamState = Session::streamState_t::BODY;
+                }
+                else
+                {
+                    session()._streamState = Session::streamState_t::DISCARD;
+
+#ifdef SYS_EX_CONF_STATS
+                    countStat(offsetof(Stats, foreignFrames));
+#endif
+                }
+            }
+        }
+    }
+    break;
+
+    case Session::streamState_t::DISCARD:
+    {
+        if (data & 0x80)
+        {
+            session()._streamState = Session::streamState_t::IDLE;
+        }
+    }
+    break;
+
+    default:
+        break;
+    }
+}
+
+///
+/// \brief Feeds chunk of incoming MIDI stream to the protocol.
+/// @param [in] data    Array with received bytes.
+/// @param [in] size    Array size.
+///
+void SysExConf::feed(const uint8_t* data, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; i++)
+    {
+        feedByte(data[i]);
+    }
+}
+
+///
+/// \brief Feeds single USB MIDI event packet to the protocol.
+/// SysEx bytes are extracted from the packet straight into the stream parser.
+/// Responses to messages received this way are sent back as USB MIDI event packets
+/// on the same virtual cable.
+/// @param [in] packet  Array holding single USB MIDI event packet (USB_MIDI_PACKET_SIZE bytes).
+///
+void SysExConf::feedUsbMidiPacket(const uint8_t* packet)
+{
+    uint8_t size = 0;
+
+    switch (static_cast<usbMidiCin_t>(packet[0] & 0x0F))
+    {
+    case usbMidiCin_t::SYS_EX_START:
+    case usbMidiCin_t::SYS_EX_END_3BYTE:
+    {
+        size = 3;
+    }
+    break;
+
+    case usbMidiCin_t::SYS_EX_END_2BYTE:
+    {
+        size = 2;
+    }
+    break;
+
+    case usbMidiCin_t::SYS_EX_END_1BYTE:
+    case usbMidiCin_t::SINGLE_BYTE:
+    {
+        size = 1;
+    }
+    break;
+
+    default:
+        return;    // not related to SysEx
+    }
+
+    session()._usbMidiCable  = packet[0] >> 4;
+    session()._usbMidiActive = true;
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        feedByte(packet[i + 1]);
+    }
+
+    session()._usbMidiActive = false;
+}
+
+///
+/// \brief Feeds array of USB MIDI event packets to the protocol.
+/// @param [in] packets Array with USB MIDI event packets.
+/// @param [in] size    Array size in bytes. Incomplete packet at the end of the array is ignored.
+///
+void SysExConf::feedUsbMidi(const uint8_t* packets, uint16_t size)
+{
+    for (uint16_t i = 0; (i + USB_MIDI_PACKET_SIZE) <= size; i += USB_MIDI_PACKET_SIZE)
+    {
+        feedUsbMidiPacket(&packets[i]);
+    }
+}
+
+///
+/// \brief Handles incoming SysEx message received on the port of specified session.
+/// All responses to the message are sent while the session is active, see port().
+/// @param [in] session Session of the port on which the message has been received.
+/// @param [in] array   SysEx array.
+/// @param [in] size    Array size.
+///
+void SysExConf::handleMessage(Session& session, const uint8_t* array, uint16_t size)
+{
+    SessionScope scope(*this, session);
+    handleMessage(array, size);
+}
+
+///
+/// \brief Feeds single byte received on the port of specified session into its stream parser.
+/// @param [in] session Session of the port on which the byte has been received.
+/// @param [in] data    Received byte.
+///
+void SysExConf::feedByte(Session& session, uint8_t data)
+{
+    SessionScope scope(*this, session);
+    feedByte(data);
+}
+
+///
+/// \brief Feeds chunk of bytes received on the port of specified session into its stream parser.
+/// @param [in] session Session of the port on which the bytes have been received.
+/// @param [in] data    Received bytes.
+/// @param [in] size    Number of received bytes.
+///
+void SysExConf::feed(Session& session, const uint8_t* data, uint16_t size)
+{
+    SessionScope scope(*this, session);
+    feed(data, size);
+}
+
+///
+/// \brief Feeds USB MIDI event packets received on the port of specified session.
+/// @param [in] session Session of the port on which the packets have been received.
+/// @param [in] packets Received packets.
+/// @param [in] size    Size of the packets array in bytes.
+///
+void SysExConf::feedUsbMidi(Session& session, const uint8_t* packets, uint16_t size)
+{
+    SessionScope scope(*this, session);
+    feedUsbMidi(packets, size);
+}
+
+///
+/// \brief Drops partially received message.
+/// Used when internal buffer is about to be overwritten while stream parser
+/// is in the middle of the message. Rest of that message will be ignored.
+///
+void SysExConf::abortStream()
+{
+    if ((session()._streamState == Session::streamState_t::HEADER) || (session()._streamState == Session::streamState_t::BODY))
+    {
+        session()._streamState = Session::streamState_t::DISCARD;
+    }
 }
 
 ///
@@ -199,14 +651,14 @@ void SysExConf::handleMessage(const uint8_t* array, uint16_t size)
 ///
 void SysExConf::resetDecodedMessage()
 {
-    _decodedMessage.status   = status_t::ACK;
-    _decodedMessage.wish     = wish_t::INVALID;
-    _decodedMessage.amount   = amount_t::INVALID;
-    _decodedMessage.block    = 0;
-    _decodedMessage.section  = 0;
-    _decodedMessage.part     = 0;
-    _decodedMessage.index    = 0;
-    _decodedMessage.newValue = 0;
+    session()._decodedMessage.status   = status_t::ACK;
+    session()._decodedMessage.wish     = wish_t::INVALID;
+    session()._decodedMessage.amount   = amount_t::INVALID;
+    session()._decodedMessage.block    = 0;
+    session()._decodedMessage.section  = 0;
+    session()._decodedMessage.part     = 0;
+    session()._decodedMessage.index    = 0;
+    session()._decodedMessage.newValue = 0;
 }
 
 ///
@@ -215,7 +667,7 @@ void SysExConf::resetDecodedMessage()
 ///
 bool SysExConf::decode(const uint8_t* receivedArray, uint16_t receivedArraySize)
 {
-    if (receivedArraySize == SPECIAL_REQ_MSG_SIZE)
+    if ((receivedArraySize == SPECIAL_REQ_MSG_SIZE) || (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE))
     {
         // special request
         return true;    // checked in processSpecialRequest
@@ -227,7 +679,7 @@ bool SysExConf::decode(const uint8_t* receivedArray, uint16_t receivedArraySize)
         return false;
     }
 
-    if (!_sysExEnabled)
+    if (!session()._sysExEnabled)
     {
         // connection open request hasn't been received
         setStatus(status_t::ERROR_CONNECTION);
@@ -235,11 +687,11 @@ bool SysExConf::decode(const uint8_t* receivedArray, uint16_t receivedArraySize)
     }
 
     // don't try to request these parameters if the size is too small
-    _decodedMessage.part    = receivedArray[static_cast<uint8_t>(byteOrder_t::PART_BYTE)];
-    _decodedMessage.wish    = static_cast<wish_t>(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
-    _decodedMessage.amount  = static_cast<amount_t>(receivedArray[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)]);
-    _decodedMessage.block   = receivedArray[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)];
-    _decodedMessage.section = receivedArray[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)];
+    session()._decodedMessage.part    = receivedArray[static_cast<uint8_t>(byteOrder_t::PART_BYTE)];
+    session()._decodedMessage.wish    = static_cast<wish_t>(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]);
+    session()._decodedMessage.amount  = static_cast<amount_t>(receivedArray[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)]);
+    session()._decodedMessage.block   = receivedArray[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)];
+    session()._decodedMessage.section = receivedArray[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)];
 
     if (!checkWish())
     {
@@ -271,7 +723,8 @@ bool SysExConf::decode(const uint8_t* receivedArray, uint16_t receivedArraySize)
         return false;
     }
 
-    if (receivedArraySize != generateMessageLenght())
+    // length of compressed values is verified once they're decoded
+    if (!isCompressedPayload() && (receivedArraySize != generateMessageLenght()))
     {
         setStatus(status_t::ERROR_MESSAGE_LENGTH);
         return false;
@@ -280,15 +733,15 @@ bool SysExConf::decode(const uint8_t* receivedArray, uint16_t receivedArraySize)
     // start building response
     setStatus(status_t::ACK);
 
-    if (_decodedMessage.amount == amount_t::SINGLE)
+    if (session()._decodedMessage.amount == amount_t::SINGLE)
     {
-        auto mergedIndex      = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)], receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 1]);
-        _decodedMessage.index = mergedIndex.value();
+        auto mergedIndex                = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)], receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 1]);
+        session()._decodedMessage.index = mergedIndex.value();
 
-        if (_decodedMessage.wish == wish_t::SET)
+        if (session()._decodedMessage.wish == wish_t::SET)
         {
-            auto mergedNewValue      = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + BYTES_PER_VALUE], receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + BYTES_PER_VALUE + 1]);
-            _decodedMessage.newValue = mergedNewValue.value();
+            auto mergedNewValue                = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + BYTES_PER_VALUE], receivedArray[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + BYTES_PER_VALUE + 1]);
+            session()._decodedMessage.newValue = mergedNewValue.value();
         }
     }
 
@@ -296,324 +749,252 @@ bool SysExConf::decode(const uint8_t* receivedArray, uint16_t receivedArraySize)
 }
 
 ///
-/// \brief Used to process standard SysEx request.
+/// \brief Used to process standard SysEx request with data handler specified in constructor.
 /// \returns True on success, false otherwise.
 ///
-bool SysExConf::processStandardRequest(uint16_t receivedArraySize)
+bool SysExConf::handleStandardRequest(const uint8_t* receivedArray, uint16_t receivedArraySize)
 {
-    uint16_t startIndex = 0, endIndex = 1;
-    uint8_t  msgPartsLoop = 1, responseCounterLocal = _responseCounter;
-    bool     allPartsAck  = false;
-    bool     allPartsLoop = false;
+    return processStandardRequest(_dataHandler, receivedArray, receivedArraySize);
+}
 
-    if ((_decodedMessage.wish == wish_t::BACKUP) || (_decodedMessage.wish == wish_t::GET))
-    {
-        if ((_decodedMessage.part == 127) || (_decodedMessage.part == 126))
-        {
-            // when parts 127 or 126 are specified, protocol will loop over all message parts and
-            // deliver as many messages as there are parts as response
-            msgPartsLoop = LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].parts();
-            allPartsLoop = true;
+///
+/// \brief Checks whether the manufacturer ID in message is correct.
+/// @returns    True if valid, false otherwise.
+///
+bool SysExConf::checkManufacturerId(const uint8_t* receivedArray)
+{
+    return (
+        (receivedArray[static_cast<uint8_t>(byteOrder_t::ID_BYTE_1)] == _manufacturerId.id1) &&
+        (receivedArray[static_cast<uint8_t>(byteOrder_t::ID_BYTE_2)] == _manufacturerId.id2) &&
+        (receivedArray[static_cast<uint8_t>(byteOrder_t::ID_BYTE_3)] == _manufacturerId.id3));
+}
 
-            // when part is set to 126 (0x7E), status_t::ack message will be sent as the last message
-            // indicating that all messages have been sent as response to specific request
-            if (_decodedMessage.part == 126)
-            {
-                allPartsAck = true;
-            }
-        }
+///
+/// \brief Checks whether the status byte in request is correct.
+/// @returns    True if valid, false otherwise.
+///
+bool SysExConf::checkStatus(const uint8_t* receivedArray)
+{
+    return (static_cast<status_t>(receivedArray[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)]) == status_t::REQUEST);
+}
 
-        if (_decodedMessage.wish == wish_t::BACKUP)
-        {
-            // convert response to request
-            _responseArray[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = static_cast<uint8_t>(status_t::REQUEST);
-            // now convert wish to set
-            _responseArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = (uint8_t)wish_t::SET;
-            // decoded message wish needs to be set to get so that we can retrieve parameters
-            _decodedMessage.wish = wish_t::GET;
-            // when backup is request, erase received index/new value in response
-            responseCounterLocal = receivedArraySize - 1 - (2 * BYTES_PER_VALUE);
-        }
-    }
+///
+/// \brief Used to process special SysEx request.
+/// Only the requests for number of parameters per message and compression can contain a value.
+/// \returns True on success, false otherwise.
+///
+bool SysExConf::processSpecialRequest(const uint8_t* receivedArray, uint16_t receivedArraySize)
+{
+    uint8_t requestId = receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)];
 
-    for (int j = 0; j < msgPartsLoop; j++)
+    if ((receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE) &&
+        (requestId != static_cast<uint8_t>(specialRequest_t::PARAMS_PER_MESSAGE)) &&
+        (requestId != static_cast<uint8_t>(specialRequest_t::COMPRESSION)) &&
+        (requestId != static_cast<uint8_t>(specialRequest_t::WINDOW)) &&
+        (requestId != static_cast<uint8_t>(specialRequest_t::STATS)))
     {
-        _responseCounter = responseCounterLocal;
+        setStatus(status_t::ERROR_MESSAGE_LENGTH);
+        return true;
+    }
 
-        if (allPartsLoop)
+    switch (requestId)
+    {
+    case static_cast<uint8_t>(specialRequest_t::CONN_CLOSE):
+    {
+        if (!session()._sysExEnabled)
         {
-            _decodedMessage.part                                         = j;
-            _responseArray[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = j;
+            // connection can't be closed if it isn't opened
+            setStatus(status_t::ERROR_CONNECTION);
+            return true;
         }
 
-        if (_decodedMessage.amount == amount_t::ALL)
-        {
-            startIndex = PARAMS_PER_MESSAGE * _decodedMessage.part;
-            endIndex   = startIndex + PARAMS_PER_MESSAGE;
+        // store all deferred writes once the host is done
+        flush();
 
-            if (endIndex > LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].numberOfParameters())
-            {
-                endIndex = LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].numberOfParameters();
-            }
-        }
+        // close sysex connection
+        discardStaged(session());
+        session()._sysExEnabled     = false;
+        session()._paramsPerMessage = PARAMS_PER_MESSAGE;
+        session()._compression      = compression_t::NONE;
+        session()._windowSize       = 0;
+        setStatus(status_t::ACK);
 
-        for (uint16_t i = startIndex; i < endIndex; i++)
-        {
-            switch (_decodedMessage.wish)
-            {
-            case wish_t::GET:
-            {
-                if (_decodedMessage.amount == amount_t::SINGLE)
-                {
-                    if (!checkParameterIndex())
-                    {
-                        setStatus(status_t::ERROR_INDEX);
-                        return false;
-                    }
-
-                    uint16_t value  = 0;
-                    uint8_t  result = _dataHandler.get(_decodedMessage.block, _decodedMessage.section, _decodedMessage.index, value);
-
-                    switch (result)
-                    {
-                    case static_cast<uint8_t>(status_t::ACK):
-                    {
-                        addToResponse(value);
-                    }
-                    break;
-
-                    default:
-                    {
-                        if (_userErrorIgnoreModeEnabled)
-                        {
-                            value = 0;
-                            addToResponse(value);
-                        }
-                        else
-                        {
-                            setStatus(result);
-                            return false;
-                        }
-                    }
-                    break;
-                    }
-                }
-                else
-                {
-                    // get all params - no index is specified
-                    uint16_t value  = 0;
-                    uint8_t  result = _dataHandler.get(_decodedMessage.block, _decodedMessage.section, i, value);
-
-                    switch (result)
-                    {
-                    case static_cast<uint8_t>(status_t::ACK):
-                    {
-                        addToResponse(value);
-                    }
-                    break;
+        return true;
+    }
+    break;
 
-                    default:
-                    {
-                        if (_userErrorIgnoreModeEnabled)
-                        {
-                            value = 0;
-                            addToResponse(value);
-                        }
-                        else
-                        {
-                            setStatus(result);
-                            return false;
-                        }
-                    }
-                    break;
-                    }
-                }
-            }
-            break;
+    case static_cast<uint8_t>(specialRequest_t::CONN_OPEN):
+    {
+        // necessary to allow the configuration
+        // each session starts with default number of parameters per message, without compression
+        discardStaged(session());
+        session()._sysExEnabled     = true;
+        session()._paramsPerMessage = PARAMS_PER_MESSAGE;
+        session()._compression      = compression_t::NONE;
+        session()._windowSize       = 0;
+        setStatus(status_t::ACK);
 
-            default:
-            {
-                // case wish_t::set:
-                if (_decodedMessage.amount == amount_t::SINGLE)
-                {
-                    if (!checkParameterIndex())
-                    {
-                        setStatus(status_t::ERROR_INDEX);
-                        return false;
-                    }
+        return true;
+    }
+    break;
 
-                    if (!checkNewValue())
-                    {
-                        setStatus(status_t::ERROR_NEW_VALUE);
-                        return false;
-                    }
+    case static_cast<uint8_t>(specialRequest_t::BYTES_PER_VALUE):
+    {
+        if (session()._sysExEnabled)
+        {
+            setStatus(status_t::ACK);
 
-                    uint8_t result = _dataHandler.set(_decodedMessage.block, _decodedMessage.section, _decodedMessage.index, _decodedMessage.newValue);
+            session()._response[session()._responseCounter++] = 0;
+            session()._response[session()._responseCounter++] = BYTES_PER_VALUE;
+        }
+        else
+        {
+            setStatus(status_t::ERROR_CONNECTION);
+        }
+        return true;
+    }
+    break;
 
-                    switch (result)
-                    {
-                    case static_cast<uint8_t>(status_t::ACK):
-                        break;
+    case static_cast<uint8_t>(specialRequest_t::PARAMS_PER_MESSAGE):
+    {
+        if (!session()._sysExEnabled)
+        {
+            setStatus(status_t::ERROR_CONNECTION);
+            return true;
+        }
 
-                    default:
-                    {
-                        if (!_userErrorIgnoreModeEnabled)
-                        {
-                            setStatus(result);
-                            return false;
-                        }
-                    }
-                    break;
-                    }
-                }
-                else
-                {
-                    uint8_t arrayIndex = (i - startIndex);
+        if (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE)
+        {
+            // host requests different number of parameters per message for this session
+            // response is the request itself with status set
+            auto merge = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]);
 
-                    arrayIndex *= BYTES_PER_VALUE;
-                    arrayIndex += static_cast<uint8_t>(byteOrder_t::INDEX_BYTE);
+            if ((merge.value() < PARAMS_PER_MESSAGE) || (merge.value() > MAX_PARAMS_PER_MESSAGE))
+            {
+                setStatus(status_t::ERROR_NEW_VALUE);
+                return true;
+            }
 
-                    auto merge               = Merge14Bit(_responseArray[arrayIndex], _responseArray[arrayIndex + 1]);
-                    _decodedMessage.newValue = merge.value();
+            // staged parts can't be combined with parts of different size
+            discardStaged(session());
+            session()._paramsPerMessage = merge.value();
+            setStatus(status_t::ACK);
 
-                    if (!checkNewValue())
-                    {
-                        setStatus(status_t::ERROR_NEW_VALUE);
-                        return false;
-                    }
+            return true;
+        }
 
-                    uint8_t result = _dataHandler.set(_decodedMessage.block, _decodedMessage.section, i, _decodedMessage.newValue);
+        setStatus(status_t::ACK);
+        addToResponse(session()._paramsPerMessage);
 
-                    switch (result)
-                    {
-                    case static_cast<uint8_t>(status_t::ACK):
-                        break;
+        return true;
+    }
+    break;
 
-                    default:
-                    {
-                        if (!_userErrorIgnoreModeEnabled)
-                        {
-                            setStatus(result);
-                            return false;
-                        }
-                    }
-                    break;
-                    }
-                }
-            }
-            break;
-            }
+    case static_cast<uint8_t>(specialRequest_t::CHECKPOINT):
+    {
+        if (!session()._sysExEnabled)
+        {
+            setStatus(status_t::ERROR_CONNECTION);
+        }
+        else if (!_dirtyTrackingEnabled)
+        {
+            setStatus(status_t::ERROR_NOT_SUPPORTED);
+        }
+        else
+        {
+            // host has stored all reported parameters
+            checkpoint();
+            setStatus(status_t::ACK);
         }
 
-        sendResponse(false);
+        return true;
     }
+    break;
 
-    if (allPartsAck)
-    {
-        // send status_t::ack message at the end
-        _responseCounter                   = 0;
-        _responseArray[_responseCounter++] = 0xF0;
-        _responseArray[_responseCounter++] = _manufacturerId.id1;
-        _responseArray[_responseCounter++] = _manufacturerId.id2;
-        _responseArray[_responseCounter++] = _manufacturerId.id3;
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(status_t::ACK);
-        _responseArray[_responseCounter++] = 0x7E;
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(_decodedMessage.wish);
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(_decodedMessage.amount);
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(_decodedMessage.block);
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(_decodedMessage.section);
-        _responseArray[_responseCounter++] = 0;
-        _responseArray[_responseCounter++] = 0;
-        _responseArray[_responseCounter++] = 0;
-        _responseArray[_responseCounter++] = 0;
-
-        sendResponse(false);
-    }
+    case static_cast<uint8_t>(specialRequest_t::COMPRESSION):
+    {
+        if (!session()._sysExEnabled)
+        {
+            setStatus(status_t::ERROR_CONNECTION);
+            return true;
+        }
 
-    return true;
-}
+        if (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE)
+        {
+            // host requests different encoding of values for this session
+            // response is the request itself with status set
+            auto merge = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]);
 
-///
-/// \brief Checks whether the manufacturer ID in message is correct.
-/// @returns    True if valid, false otherwise.
-///
-bool SysExConf::checkManufacturerId()
-{
-    return (
-        (_responseArray[static_cast<uint8_t>(byteOrder_t::ID_BYTE_1)] == _manufacturerId.id1) &&
-        (_responseArray[static_cast<uint8_t>(byteOrder_t::ID_BYTE_2)] == _manufacturerId.id2) &&
-        (_responseArray[static_cast<uint8_t>(byteOrder_t::ID_BYTE_3)] == _manufacturerId.id3));
-}
+            if (merge.value() >= static_cast<uint16_t>(compression_t::AMOUNT))
+            {
+                setStatus(status_t::ERROR_NEW_VALUE);
+                return true;
+            }
 
-///
-/// \brief Checks whether the status byte in request is correct.
-/// @returns    True if valid, false otherwise.
-///
-bool SysExConf::checkStatus()
-{
-    return (static_cast<status_t>(_responseArray[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)]) == status_t::REQUEST);
-}
+            session()._compression = static_cast<compression_t>(merge.value());
+            setStatus(status_t::ACK);
 
-///
-/// \brief Used to process special SysEx request.
-/// \returns True on success, false otherwise.
-///
-bool SysExConf::processSpecialRequest()
-{
-    switch (_responseArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)])
-    {
-    case static_cast<uint8_t>(specialRequest_t::CONN_CLOSE):
-    {
-        if (!_sysExEnabled)
-        {
-            // connection can't be closed if it isn't opened
-            setStatus(status_t::ERROR_CONNECTION);
             return true;
         }
 
-        // close sysex connection
-        _sysExEnabled = false;
         setStatus(status_t::ACK);
+        addToResponse(static_cast<uint16_t>(session()._compression));
 
         return true;
     }
     break;
 
-    case static_cast<uint8_t>(specialRequest_t::CONN_OPEN):
+    case static_cast<uint8_t>(specialRequest_t::WINDOW):
     {
-        // necessary to allow the configuration
-        _sysExEnabled = true;
+        if (!session()._sysExEnabled)
+        {
+            setStatus(status_t::ERROR_CONNECTION);
+            return true;
+        }
+
+        if (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE)
+        {
+            // host requests flow control of multi-part responses for this session
+            // response is the request itself with status set
+            auto merge = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]);
+
+            session()._windowSize = merge.value();
+            setStatus(status_t::ACK);
+
+            return true;
+        }
+
         setStatus(status_t::ACK);
+        addToResponse(session()._windowSize);
 
         return true;
     }
     break;
 
-    case static_cast<uint8_t>(specialRequest_t::BYTES_PER_VALUE):
+    case static_cast<uint8_t>(specialRequest_t::STATS):
     {
-        if (_sysExEnabled)
-        {
-            setStatus(status_t::ACK);
-
-            _responseArray[_responseCounter++] = 0;
-            _responseArray[_responseCounter++] = BYTES_PER_VALUE;
-        }
-        else
+        if (!session()._sysExEnabled)
         {
             setStatus(status_t::ERROR_CONNECTION);
+            return true;
         }
+
+#ifdef SYS_EX_CONF_STATS
+        processStatsRequest(receivedArray, receivedArraySize);
+#else
+        setStatus(status_t::ERROR_NOT_SUPPORTED);
+#endif
+
         return true;
     }
     break;
 
-    case static_cast<uint8_t>(specialRequest_t::PARAMS_PER_MESSAGE):
+    case static_cast<uint8_t>(specialRequest_t::MAX_PARAMS_PER_MESSAGE):
     {
-        if (_sysExEnabled)
+        if (session()._sysExEnabled)
         {
             setStatus(status_t::ACK);
-
-            _responseArray[_responseCounter++] = 0;
-            _responseArray[_responseCounter++] = PARAMS_PER_MESSAGE;
+            addToResponse(MAX_PARAMS_PER_MESSAGE);
         }
         else
         {
@@ -627,20 +1008,17 @@ bool SysExConf::processSpecialRequest()
     default:
     {
         // check for custom value
-        for (size_t i = 0; i < _sysExCustomRequest.size(); i++)
+        if ((requestId < _customRequestTable.size()) && (_customRequestTable[requestId] != NO_CUSTOM_REQUEST))
         {
-            // check only current wish/request
-            if (_sysExCustomRequest[i].requestId != _responseArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)])
-            {
-                continue;
-            }
+            auto& customRequest = _sysExCustomRequest[_customRequestTable[requestId]];
 
-            if (_sysExEnabled || !_sysExCustomRequest[i].connOpenCheck)
+            if (session()._sysExEnabled || !customRequest.connOpenCheck)
             {
                 setStatus(status_t::ACK);
 
-                DataHandler::CustomResponse customResponse(_responseArray, _responseCounter);
-                uint8_t                     result = _dataHandler.customRequest(_sysExCustomRequest[i].requestId, customResponse);
+                DataHandler::CustomResponse customResponse(session()._response, session()._responseCounter);
+                uint8_t                     result = customRequest.handler ? customRequest.handler(customRequest.context, customRequest.requestId, customResponse)
+                                                                           : _dataHandler.customRequest(customRequest.requestId, customResponse);
 
                 switch (result)
                 {
@@ -678,122 +1056,383 @@ bool SysExConf::processSpecialRequest()
 }
 
 ///
-/// \brief Generates message length based on other parameters in message.
-/// \returns    Message length in bytes.
+/// \brief Used to process request for values of all parameters in layout.
+/// Every section is processed as request for all parameters with part set to 127,
+/// so that all responses are streamed without further requests from the host.
+/// Responses are get responses by default, or backup ones if the request contains
+/// wish_t::BACKUP as a value. When part of the request is set to 126, the request itself
+/// is sent back with status_t::ACK once all sections have been sent.
+/// \returns True if all responses have been sent, false if the response
+///          still needs to be sent (final ACK or error).
 ///
-uint16_t SysExConf::generateMessageLenght()
+bool SysExConf::processDumpRequest(const uint8_t* receivedArray, uint16_t receivedArraySize)
 {
-    uint16_t size = 0;
-
-    switch (_decodedMessage.amount)
+    if (!session()._sysExEnabled)
     {
-    case amount_t::SINGLE:
-        return STD_REQ_MIN_MSG_SIZE;
+        setStatus(status_t::ERROR_CONNECTION);
+        return false;
+    }
 
-    default:
+    auto wish = wish_t::GET;
+
+    if (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE)
     {
-        // case amount_t::all:
-        switch (_decodedMessage.wish)
-        {
-        case wish_t::GET:
-        case wish_t::BACKUP:
-            return STD_REQ_MIN_MSG_SIZE;
+        auto merge = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]);
 
-        default:
+        if ((merge.value() != static_cast<uint16_t>(wish_t::GET)) && (merge.value() != static_cast<uint16_t>(wish_t::BACKUP)))
         {
-            // case wish_t::set:
-            size = LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].numberOfParameters();
+            setStatus(status_t::ERROR_NEW_VALUE);
+            return false;
+        }
 
-            if (size > PARAMS_PER_MESSAGE)
-            {
-                if ((_decodedMessage.part + 1) == LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].parts())
-                {
-                    size = size - ((LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].parts() - 1) * PARAMS_PER_MESSAGE);
-                }
-                else
-                {
-                    size = PARAMS_PER_MESSAGE;
-                }
-            }
+        wish = static_cast<wish_t>(merge.value());
+    }
 
-            size *= BYTES_PER_VALUE;
-            size += static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 1;
+    // request can be located in response buffer which is overwritten for each section
+    std::copy(receivedArray, receivedArray + receivedArraySize, session()._transfer.dumpRequest);
 
-            return size;
-        }
-        break;
-        }
-    }
-    break;
-    }
+    session()._transfer.dumpRequestSize = receivedArraySize;
+    session()._transfer.dumpWish        = wish;
+    session()._transfer.block           = 0;
+    session()._transfer.section         = 0;
 
-    return size;
+    return continueDump();
 }
 
 ///
-/// \brief Checks whether the wish value is valid.
-/// \returns    True if valid, false otherwise.
+/// \brief Sends responses for all sections starting from the one stored in transfer cursor.
+/// Dump is paused once flow control window is exhausted.
+/// \returns True if all responses have been sent, false if the response
+///          still needs to be sent (final ACK or error).
 ///
-bool SysExConf::checkWish()
+bool SysExConf::continueDump()
 {
-    return (_decodedMessage.wish <= wish_t::BACKUP);
-}
+    uint8_t sectionRequest[STD_REQ_MIN_MSG_SIZE] = {};
 
-///
-/// \brief Checks whether the amount value is valid.
-/// \returns    True if valid, false otherwise.
-///
-bool SysExConf::checkAmount()
-{
-    return (_decodedMessage.amount <= amount_t::ALL);
-}
+    std::copy(session()._transfer.dumpRequest, session()._transfer.dumpRequest + static_cast<uint8_t>(byteOrder_t::STATUS_BYTE), sectionRequest);
 
-///
-/// \brief Checks whether the block value is valid.
-/// \returns    True if valid, false otherwise.
-///
-bool SysExConf::checkBlock()
-{
-    return _decodedMessage.block < LAYOUT_ACCESS.size();
-}
+    sectionRequest[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] = static_cast<uint8_t>(status_t::REQUEST);
+    sectionRequest[static_cast<uint8_t>(byteOrder_t::PART_BYTE)]   = 127;
+    sectionRequest[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]   = static_cast<uint8_t>(session()._transfer.dumpWish);
+    sectionRequest[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)] = static_cast<uint8_t>(amount_t::ALL);
+    sectionRequest[STD_REQ_MIN_MSG_SIZE - 1]                       = 0xF7;
 
-///
-/// \brief Checks whether the section value is valid.
-/// \returns    True if valid, false otherwise.
-///
-bool SysExConf::checkSection()
-{
-    return (_decodedMessage.section < LAYOUT_ACCESS[_decodedMessage.block]._sections.size());
-}
+    session()._transfer.dumpPaused = false;
 
-///
-/// \brief Checks whether the message part is valid.
-/// \returns    True if valid, false otherwise.
-///
-bool SysExConf::checkPart()
-{
-    if ((_decodedMessage.part == 127) || (_decodedMessage.part == 126))
+    while (session()._transfer.block < blocks())
     {
-        if ((_decodedMessage.wish == wish_t::GET) || (_decodedMessage.wish == wish_t::BACKUP))
+        uint8_t block        = session()._transfer.block;
+        uint8_t sectionIndex = session()._transfer.section;
+
+        // cursor is moved first so that paused dump continues with the next section once this one is done
+        if (++session()._transfer.section >= sections(block))
         {
-            return true;
+            session()._transfer.section = 0;
+            session()._transfer.block++;
         }
 
-        return false;
-    }
+        if (!section(block, sectionIndex).numberOfParameters)
+        {
+            continue;
+        }
 
-    if (_decodedMessage.amount == amount_t::ALL)
-    {
-        if (_decodedMessage.part >= LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].parts())
+        sectionRequest[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)]   = block;
+        sectionRequest[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = sectionIndex;
+
+        // response is built on top of the request, same as in handleMessage
+        std::copy(sectionRequest, sectionRequest + STD_REQ_MIN_MSG_SIZE, session()._responseArray);
+
+        session()._responseCounter = STD_REQ_MIN_MSG_SIZE - 1;
+        resetDecodedMessage();
+
+        if (!decode(sectionRequest, STD_REQ_MIN_MSG_SIZE) || !handleStandardRequest(sectionRequest, STD_REQ_MIN_MSG_SIZE))
         {
+            // stop on first error and report it with the header of failed section
+            resetDecodedMessage();
             return false;
         }
 
-        return true;
+        if (session()._transfer.sectionPaused)
+        {
+            session()._transfer.dumpPaused = true;
+            return true;
+        }
+    }
+
+    resetDecodedMessage();
+
+    if (session()._transfer.dumpRequest[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] != 126)
+    {
+        return true;
+    }
+
+    if (!takeWindowCredit())
+    {
+        // only final ACK is left
+        session()._transfer.dumpPaused = true;
+        return true;
+    }
+
+    std::copy(session()._transfer.dumpRequest, session()._transfer.dumpRequest + session()._transfer.dumpRequestSize, session()._responseArray);
+
+    session()._responseCounter = session()._transfer.dumpRequestSize - 1;
+    setStatus(status_t::ACK);
+
+    return false;
+}
+
+///
+/// \brief Used to process acknowledgement of multi-part response frames.
+/// Request without value acknowledges all frames sent so far, otherwise the value
+/// specifies the number of acknowledged frames. Paused transfer is resumed and
+/// continues until the window is exhausted again. Request isn't answered on success.
+/// \returns True if all responses have been sent, false if the response
+///          still needs to be sent (error or final ACK of the dump).
+///
+bool SysExConf::processWindowAck(const uint8_t* receivedArray, uint16_t receivedArraySize)
+{
+    if (!session()._sysExEnabled)
+    {
+        setStatus(status_t::ERROR_CONNECTION);
+        return false;
+    }
+
+    if (!session()._windowSize)
+    {
+        setStatus(status_t::ERROR_NOT_SUPPORTED);
+        return false;
+    }
+
+    if (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE)
+    {
+        auto merge = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]);
+
+        session()._windowCredits = std::min<uint32_t>(session()._windowCredits + merge.value(), session()._windowSize);
+    }
+    else
+    {
+        session()._windowCredits = session()._windowSize;
+    }
+
+    if (session()._transfer.sectionPaused)
+    {
+        // response is built on top of the request, same as in handleMessage
+        std::copy(session()._transfer.request, session()._transfer.request + STD_REQ_MIN_MSG_SIZE, session()._responseArray);
+
+        session()._responseCounter        = STD_REQ_MIN_MSG_SIZE - 1;
+        session()._transfer.sectionPaused = false;
+        session()._transferResuming       = true;
+        resetDecodedMessage();
+
+        bool result = decode(session()._transfer.request, STD_REQ_MIN_MSG_SIZE) && handleStandardRequest(session()._transfer.request, STD_REQ_MIN_MSG_SIZE);
+
+        session()._transferResuming = false;
+
+        if (!result)
+        {
+            resetDecodedMessage();
+            session()._transfer.dumpPaused = false;
+            return false;
+        }
+
+        if (session()._transfer.sectionPaused)
+        {
+            return true;
+        }
+    }
+
+    if (session()._transfer.dumpPaused)
+    {
+        return continueDump();
+    }
+
+    return true;
+}
+
+///
+/// \brief Cancels paused transfer and restores full flow control window.
+///
+void SysExConf::resetWindow()
+{
+    session()._windowCredits          = session()._windowSize;
+    session()._transfer.sectionPaused = false;
+    session()._transfer.dumpPaused    = false;
+}
+
+///
+/// \brief Takes single frame from flow control window.
+/// \returns True if the frame can be sent, false if the window is exhausted.
+///
+bool SysExConf::takeWindowCredit()
+{
+    if (!session()._windowSize)
+    {
+        return true;
+    }
+
+    if (!session()._windowCredits)
+    {
+        return false;
+    }
+
+    session()._windowCredits--;
+    return true;
+}
+
+///
+/// \brief Stores request for all parts of the section so that its transfer can be resumed.
+/// @param [in] receivedArray   Request array.
+///
+void SysExConf::saveTransferRequest(const uint8_t* receivedArray)
+{
+    std::copy(receivedArray, receivedArray + STD_REQ_MIN_MSG_SIZE, session()._transfer.request);
+}
+
+///
+/// \brief Pauses transfer of current section until the host acknowledges sent frames.
+/// @param [in] nextPart    Part to send once the transfer is resumed.
+///
+void SysExConf::pauseTransfer(uint8_t nextPart)
+{
+    session()._transfer.nextPart      = nextPart;
+    session()._transfer.sectionPaused = true;
+}
+
+///
+/// \brief Generates message length based on other parameters in message.
+/// \returns    Message length in bytes.
+///
+uint16_t SysExConf::generateMessageLenght()
+{
+    uint16_t size = 0;
+
+    switch (session()._decodedMessage.amount)
+    {
+    case amount_t::SINGLE:
+        return STD_REQ_MIN_MSG_SIZE;
+
+    default:
+    {
+        // case amount_t::all:
+        switch (session()._decodedMessage.wish)
+        {
+        case wish_t::GET:
+        case wish_t::BACKUP:
+            return STD_REQ_MIN_MSG_SIZE;
+
+        default:
+        {
+            // case wish_t::set:
+            auto& descriptor = section(session()._decodedMessage.block, session()._decodedMessage.section);
+
+            if ((session()._decodedMessage.part + 1) == parts(descriptor))
+            {
+                size = lastPartParameters(descriptor);
+            }
+            else
+            {
+                size = session()._paramsPerMessage;
+            }
+
+            size *= BYTES_PER_VALUE;
+            size += static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 1;
+
+            return size;
+        }
+        break;
+        }
+    }
+    break;
+    }
+
+    return size;
+}
+
+///
+/// \brief Checks whether the request contains run-length coded values.
+/// \returns True if compressed, false otherwise.
+///
+bool SysExConf::isCompressedPayload() const
+{
+    return (session()._compression == compression_t::RLE) && (session()._decodedMessage.wish == wish_t::SET) && (session()._decodedMessage.amount == amount_t::ALL);
+}
+
+///
+/// \brief Checks whether the wish value is valid.
+/// \returns    True if valid, false otherwise.
+///
+bool SysExConf::checkWish()
+{
+    return (session()._decodedMessage.wish <= wish_t::BACKUP);
+}
+
+///
+/// \brief Checks whether the amount value is valid.
+/// \returns    True if valid, false otherwise.
+///
+bool SysExConf::checkAmount()
+{
+    if (session()._decodedMessage.amount == amount_t::CHANGED)
+    {
+        // changed parameters can only be retrieved
+        return _dirtyTrackingEnabled && (session()._decodedMessage.wish == wish_t::GET);
+    }
+
+    return (session()._decodedMessage.amount <= amount_t::ALL);
+}
+
+///
+/// \brief Checks whether the block value is valid.
+/// \returns    True if valid, false otherwise.
+///
+bool SysExConf::checkBlock()
+{
+    return session()._decodedMessage.block < blocks();
+}
+
+///
+/// \brief Checks whether the section value is valid.
+/// \returns    True if valid, false otherwise.
+///
+bool SysExConf::checkSection()
+{
+    return (session()._decodedMessage.section < sections(session()._decodedMessage.block));
+}
+
+///
+/// \brief Checks whether the message part is valid.
+/// \returns    True if valid, false otherwise.
+///
+bool SysExConf::checkPart()
+{
+    if ((session()._decodedMessage.part == 127) || (session()._decodedMessage.part == 126))
+    {
+        if ((session()._decodedMessage.wish == wish_t::GET) || (session()._decodedMessage.wish == wish_t::BACKUP))
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    if (session()._decodedMessage.amount == amount_t::CHANGED)
+    {
+        // number of parts depends on number of changed parameters, empty parts are allowed
+        return true;
+    }
+
+    if (session()._decodedMessage.amount == amount_t::ALL)
+    {
+        if (session()._decodedMessage.part >= parts(section(session()._decodedMessage.block, session()._decodedMessage.section)))
+        {
+            return false;
+        }
+
+        return true;
     }
 
     // do not allow part other than 0 in single mode
-    if (_decodedMessage.part)
+    if (session()._decodedMessage.part)
     {
         return false;
     }
@@ -808,7 +1447,7 @@ bool SysExConf::checkPart()
 bool SysExConf::checkParameterIndex()
 {
     // block and section passed validation, check parameter index
-    return (_decodedMessage.index < LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].numberOfParameters());
+    return (session()._decodedMessage.index < section(session()._decodedMessage.block, session()._decodedMessage.section).numberOfParameters);
 }
 
 ///
@@ -817,19 +1456,20 @@ bool SysExConf::checkParameterIndex()
 ///
 bool SysExConf::checkNewValue()
 {
-    uint16_t minValue = LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].newValueMin();
-    uint16_t maxValue = LAYOUT_ACCESS[_decodedMessage.block]._sections[_decodedMessage.section].newValueMax();
+    auto& descriptor = section(session()._decodedMessage.block, session()._decodedMessage.section);
 
-    if (minValue != maxValue)
+    if (descriptor.noRangeCheck)
     {
-        return ((_decodedMessage.newValue >= minValue) && (_decodedMessage.newValue <= maxValue));
+        return true;    // don't check new value if min and max are the same
     }
 
-    return true;    // don't check new value if min and max are the same
+    return ((session()._decodedMessage.newValue >= descriptor.newValueMin) && (session()._decodedMessage.newValue <= descriptor.newValueMax));
 }
 
 ///
 /// \brief Used to send custom SysEx response.
+/// Message is built in its own buffer, so request which is being received in
+/// response array of the session isn't affected.
 /// @param [in] values          Array with values to send.
 /// @param [in] size            Array size.
 /// @param [in] ack             When set to true, status byte will be set to status_t::ack, otherwise status_t::request will be used.
@@ -837,29 +1477,34 @@ bool SysExConf::checkNewValue()
 ///
 void SysExConf::sendCustomMessage(const uint16_t* values, uint16_t size, bool ack)
 {
-    _responseCounter = 0;
+    uint8_t message[MAX_MESSAGE_SIZE];
+
+    session()._response           = message;
+    session()._responseCounter    = 0;
+    session()._responseHeaderSize = 0;
 
-    _responseArray[_responseCounter++] = 0xF0;
-    _responseArray[_responseCounter++] = _manufacturerId.id1;
-    _responseArray[_responseCounter++] = _manufacturerId.id2;
-    _responseArray[_responseCounter++] = _manufacturerId.id3;
+    session()._response[session()._responseCounter++] = 0xF0;
+    session()._response[session()._responseCounter++] = _manufacturerId.id1;
+    session()._response[session()._responseCounter++] = _manufacturerId.id2;
+    session()._response[session()._responseCounter++] = _manufacturerId.id3;
 
     if (ack)
     {
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(status_t::ACK);
+        session()._response[session()._responseCounter++] = static_cast<uint8_t>(status_t::ACK);
     }
     else
     {
-        _responseArray[_responseCounter++] = static_cast<uint8_t>(status_t::REQUEST);
+        session()._response[session()._responseCounter++] = static_cast<uint8_t>(status_t::REQUEST);
     }
 
-    _responseArray[_responseCounter++] = 0;    // message part
+    session()._response[session()._responseCounter++] = 0;    // message part
 
     for (uint16_t i = 0; i < size; i++)
     {
-        _responseArray[_responseCounter++] = values[i];
+        session()._response[session()._responseCounter++] = values[i];
     }
 
+    // response array is used again once the message is sent
     sendResponse(false, true);
 }
 
@@ -870,41 +1515,1395 @@ void SysExConf::sendCustomMessage(const uint16_t* values, uint16_t size, bool ac
 ///
 void SysExConf::sendResponse(bool containsLastByte, bool customMessage)
 {
-    if (!containsLastByte)
+    sendResponse(_dataHandler, containsLastByte);
+}
+
+///
+/// \brief Builds message sent after all parts of the response when part 126 is requested.
+///
+void SysExConf::buildAllPartsAck()
+{
+    session()._responseHeaderSize = 0;
+    session()._responseCounter    = 0;
+    acquireResponseSlot(0);
+
+    session()._response[session()._responseCounter++] = 0xF0;
+    session()._response[session()._responseCounter++] = _manufacturerId.id1;
+    session()._response[session()._responseCounter++] = _manufacturerId.id2;
+    session()._response[session()._responseCounter++] = _manufacturerId.id3;
+    session()._response[session()._responseCounter++] = static_cast<uint8_t>(status_t::ACK);
+    session()._response[session()._responseCounter++] = 0x7E;
+    session()._response[session()._responseCounter++] = static_cast<uint8_t>(session()._decodedMessage.wish);
+    session()._response[session()._responseCounter++] = static_cast<uint8_t>(session()._decodedMessage.amount);
+    session()._response[session()._responseCounter++] = static_cast<uint8_t>(session()._decodedMessage.block);
+    session()._response[session()._responseCounter++] = static_cast<uint8_t>(session()._decodedMessage.section);
+    session()._response[session()._responseCounter++] = 0;
+    session()._response[session()._responseCounter++] = 0;
+    session()._response[session()._responseCounter++] = 0;
+    session()._response[session()._responseCounter++] = 0;
+}
+
+///
+/// \brief Configures ring of buffers in which responses to standard requests are built.
+/// Each response is handed over to the transport with DataHandler::sendResponseSlot,
+/// so that next message part can be built while previous one is still being transmitted.
+/// @param [in] buffer          Memory for all slots, numberOfSlots * MAX_MESSAGE_SIZE bytes.
+///                             Must remain valid while the ring is in use.
+/// @param [in] numberOfSlots   Number of slots in the ring. Set to 0 to disable the ring.
+/// \returns True on success, false otherwise (too many slots).
+///
+bool SysExConf::setResponseRing(uint8_t* buffer, uint8_t numberOfSlots)
+{
+    if ((numberOfSlots > MAX_RESPONSE_SLOTS) || (numberOfSlots && (buffer == nullptr)))
+    {
+        return false;
+    }
+
+    _responseRing           = buffer;
+    _responseRingSlots      = numberOfSlots;
+    _responseRingNext       = 0;
+    session()._responseSlot = Session::NO_RESPONSE_SLOT;
+    session()._response     = session()._responseArray;
+
+    for (uint8_t i = 0; i < MAX_RESPONSE_SLOTS; i++)
     {
-        _responseArray[_responseCounter++] = 0xF7;
+        _responseSlotBusy[i].store(false, std::memory_order_relaxed);
     }
 
-    _dataHandler.sendResponse(_responseArray, _responseCounter);
+    return true;
 }
 
 ///
-/// \brief Adds value to SysEx response.
-/// This function append value to last specified SysEx array.
-/// @param [in] value   New value.
-/// \returns True on success, false otherwise.
+/// \brief Releases response ring slot once the response stored in it has been transmitted.
+/// Can be called from interrupt context.
+/// @param [in] slot    Slot index as passed to DataHandler::sendResponseSlot.
 ///
-bool SysExConf::addToResponse(uint16_t value)
+void SysExConf::releaseResponseSlot(uint8_t slot)
 {
-    auto split = Split14Bit(value);
+    // not locked so that the transport can release slots while the engine waits for them,
+    // release ordering makes sure the transport is done with the slot before it is reused
+    if (slot < _responseRingSlots)
+    {
+        _responseSlotBusy[slot].store(false, std::memory_order_release);
+    }
+}
+
+///
+/// \brief Claims next response ring slot if it isn't busy.
+/// Claimed slot is marked busy until the response is released either by the engine
+/// or by the transport once it has been transmitted.
+/// @param [out] slot   Index of the next slot in the ring.
+/// \returns True if the slot has been claimed, false if it is still busy.
+///
+bool SysExConf::claimResponseSlot(uint8_t& slot)
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    slot = _responseRingNext;
 
-    if (_responseCounter >= (MAX_MESSAGE_SIZE - 1))
+    if (_responseSlotBusy[slot].load(std::memory_order_acquire))
     {
         return false;
     }
 
-    _responseArray[_responseCounter++] = split.high();
-    _responseArray[_responseCounter++] = split.low();
+    _responseSlotBusy[slot].store(true, std::memory_order_relaxed);
+    _responseRingNext = (slot + 1) % _responseRingSlots;
 
     return true;
 }
 
-uint8_t SysExConf::blocks() const
+///
+/// \brief Starts building new response in next response ring slot.
+/// Header of the request is copied into the slot, the rest of the response is
+/// built directly in it. If the ring isn't configured or the slot is still being
+/// transmitted, response is built in response array.
+/// @param [in] headerSize  Number of bytes from response array to copy into the slot.
+///
+void SysExConf::acquireResponseSlot(uint16_t headerSize)
+{
+    if (!_responseRingSlots)
+    {
+        return;
+    }
+
+    uint8_t slot = 0;
+
+    if (!claimResponseSlot(slot))
+    {
+        // not locked so that other sessions can keep using the engine while this one waits for the transport
+        _dataHandler.waitResponseSlot(slot);
+
+        if (!claimResponseSlot(slot))
+        {
+            return;
+        }
+    }
+
+    session()._responseSlot = slot;
+    session()._response     = &_responseRing[slot * MAX_MESSAGE_SIZE];
+
+    for (uint16_t i = 0; i < headerSize; i++)
+    {
+        session()._response[i] = session()._responseArray[i];
+    }
+}
+
+///
+/// \brief Enables or disables segmented responses.
+/// When enabled, header of the response to get request for all parameters or for
+/// changed parameters is moved into separate buffer once per request, and only the
+/// part byte and payload are built for each part of the response. Parts are passed to
+/// DataHandler::sendResponseV as segments. Responses to other requests, USB MIDI
+/// responses and final ACK of multi-part responses are always sent as whole frames.
+/// @param [in] state   New segmented responses state.
+///
+void SysExConf::setSegmentedResponses(bool state)
 {
-    return LAYOUT_ACCESS.size();
+    _segmentedResponsesEnabled = state;
 }
 
-uint8_t SysExConf::sections(uint8_t blockIndex) const
+///
+/// \brief Starts sending the response as segments if segmented responses are enabled.
+/// Header is copied from response array into separate buffer, so that response buffer
+/// holds only the payload of each part.
+/// @param [in] headerSize  Size of the header at the start of response array.
+/// \returns Position in response buffer at which payload of each part starts.
+///
+uint16_t SysExConf::startSegments(uint16_t headerSize)
 {
-    return LAYOUT_ACCESS[blockIndex]._sections.size();
-}
\ No newline at end of file
+    if (!_segmentedResponsesEnabled || (headerSize <= static_cast<uint8_t>(byteOrder_t::PART_BYTE)) || (headerSize > sizeof(session()._responseHeader)))
+    {
+        return headerSize;
+    }
+
+    std::copy(session()._responseArray, session()._responseArray + headerSize, session()._responseHeader);
+
+    session()._responseHeaderSize = headerSize;
+    session()._responsePart       = session()._responseHeader[static_cast<uint8_t>(byteOrder_t::PART_BYTE)];
+
+    return 0;
+}
+
+///
+/// \brief Sets message part of the response currently being built.
+/// @param [in] part    Message part.
+///
+void SysExConf::setResponsePart(uint8_t part)
+{
+    if (session()._responseHeaderSize)
+    {
+        session()._responsePart = part;
+        return;
+    }
+
+    session()._response[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = part;
+}
+
+///
+/// \brief Assembles the whole frame from segments of the response in response buffer.
+/// Used when the transport doesn't accept segmented responses.
+///
+void SysExConf::assembleResponse()
+{
+    uint16_t headerSize = session()._responseHeaderSize;
+
+    std::copy_backward(session()._response, session()._response + session()._responseCounter, session()._response + session()._responseCounter + headerSize);
+    std::copy(session()._responseHeader, session()._responseHeader + headerSize, session()._response);
+
+    session()._response[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = session()._responsePart;
+    session()._responseCounter += headerSize;
+}
+
+///
+/// \brief Marks the response as sent and switches back to response array.
+///
+void SysExConf::releaseResponse()
+{
+    if (session()._responseSlot != Session::NO_RESPONSE_SLOT)
+    {
+        _responseSlotBusy[session()._responseSlot].store(false, std::memory_order_release);
+        session()._responseSlot = Session::NO_RESPONSE_SLOT;
+    }
+
+    session()._response = session()._responseArray;
+}
+
+///
+/// \brief Packs current response into USB MIDI event packets.
+/// \returns Size of packed response in bytes.
+///
+uint16_t SysExConf::packUsbMidi()
+{
+    uint16_t size = 0;
+
+    for (uint16_t i = 0; i < session()._responseCounter; i += 3)
+    {
+        uint16_t remaining = session()._responseCounter - i;
+        auto     cin       = usbMidiCin_t::SYS_EX_START;
+
+        if (remaining <= 3)
+        {
+            // response always ends with 0xF7
+            cin = static_cast<usbMidiCin_t>(static_cast<uint8_t>(usbMidiCin_t::SYS_EX_END_1BYTE) + remaining - 1);
+        }
+        else
+        {
+            remaining = 3;
+        }
+
+        session()._usbMidiArray[size++] = (session()._usbMidiCable << 4) | static_cast<uint8_t>(cin);
+
+        for (uint8_t j = 0; j < 3; j++)
+        {
+            session()._usbMidiArray[size++] = j < remaining ? session()._response[i + j] : 0;
+        }
+    }
+
+    return size;
+}
+
+///
+/// \brief Adds value to SysEx response.
+/// This function append value to last specified SysEx array.
+/// @param [in] value   New value.
+/// \returns True on success, false otherwise.
+///
+bool SysExConf::addToResponse(uint16_t value)
+{
+    auto split = Split14Bit(value);
+
+    if (session()._responseCounter >= (MAX_MESSAGE_SIZE - 1))
+    {
+        return false;
+    }
+
+    session()._response[session()._responseCounter++] = split.high();
+    session()._response[session()._responseCounter++] = split.low();
+
+    return true;
+}
+
+uint8_t SysExConf::blocks() const
+{
+    return _blockCount;
+}
+
+uint8_t SysExConf::sections(uint8_t blockIndex) const
+{
+    return _blocks[blockIndex].sections;
+}
+
+///
+/// \brief Retrieves total number of parameters in all sections of the layout.
+/// \returns Number of parameters.
+///
+uint32_t SysExConf::parameters() const
+{
+    if (!_blockCount)
+    {
+        return 0;
+    }
+
+    auto&    lastBlock     = _blocks[_blockCount - 1];
+    uint16_t totalSections = lastBlock.firstSection + lastBlock.sections;
+
+    if (!totalSections)
+    {
+        return 0;
+    }
+
+    return _sections[totalSections - 1].offset + _sections[totalSections - 1].numberOfParameters;
+}
+
+///
+/// \brief Retrieves number of parameters in single section.
+/// @param [in] block   Block index.
+/// @param [in] section Section index.
+/// \returns Number of parameters, or 0 if the section doesn't exist.
+///
+uint16_t SysExConf::parameters(uint8_t block, uint8_t section) const
+{
+    if ((block >= blocks()) || (section >= sections(block)))
+    {
+        return 0;
+    }
+
+    return SysExConf::section(block, section).numberOfParameters;
+}
+
+///
+/// \brief Enables or disables shadow value cache.
+/// When enabled, values retrieved from or stored with data handler are kept in RAM
+/// so that get and backup requests can be served without calling the handler.
+/// Cache is sized from the layout and is empty once enabled: it's filled as
+/// values are accessed or with fillCache. Values changed outside of the protocol
+/// must be invalidated with invalidateCache.
+/// @param [in] state   New cache state.
+/// \returns True on success, false otherwise (cache can't be enabled without layout).
+///
+bool SysExConf::setCache(bool state)
+{
+    if (state && !blocks())
+    {
+        return false;
+    }
+
+    _cacheEnabled = state;
+    resizeCache();
+
+    return true;
+}
+
+///
+/// \brief Retrieves values of all parameters in layout using data handler and stores them in cache.
+/// \returns True on success, false otherwise (cache disabled or handler error
+///          for any of the sections, in which case values from those sections aren't cached).
+///
+bool SysExConf::fillCache()
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    if (!_cacheEnabled)
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    for (uint8_t block = 0; block < blocks(); block++)
+    {
+        for (uint8_t sectionIndex = 0; sectionIndex < sections(block); sectionIndex++)
+        {
+            auto& descriptor = section(block, sectionIndex);
+
+            if (!descriptor.numberOfParameters)
+            {
+                continue;
+            }
+
+            // values are retrieved straight into the cache
+            uint8_t result = _dataHandler.getRange(block, sectionIndex, 0, descriptor.numberOfParameters, &_cache[descriptor.offset]);
+
+            if (result == static_cast<uint8_t>(status_t::ACK))
+            {
+                cacheValues(descriptor.offset, descriptor.numberOfParameters, &_cache[descriptor.offset]);
+            }
+            else
+            {
+                uncacheValues(descriptor.offset, descriptor.numberOfParameters);
+                success = false;
+            }
+        }
+    }
+
+    return success;
+}
+
+///
+/// \brief Invalidates all values in cache.
+///
+void SysExConf::invalidateCache()
+{
+    [[maybe_unused]] auto lock = lockState();
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+    _cacheGeneration++;
+#endif
+
+    std::fill(_cacheValid.begin(), _cacheValid.end(), 0);
+}
+
+///
+/// \brief Invalidates values of all parameters in section.
+/// @param [in] block   Block index.
+/// @param [in] section Section index.
+///
+void SysExConf::invalidateCache(uint8_t block, uint8_t section)
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    if (!_cacheEnabled || (block >= blocks()) || (section >= sections(block)))
+    {
+        return;
+    }
+
+    auto& descriptor = SysExConf::section(block, section);
+
+    uncacheValues(descriptor.offset, descriptor.numberOfParameters);
+}
+
+///
+/// \brief Invalidates value of single parameter.
+/// @param [in] block   Block index.
+/// @param [in] section Section index.
+/// @param [in] index   Parameter index.
+///
+void SysExConf::invalidateCache(uint8_t block, uint8_t section, uint16_t index)
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    if (!_cacheEnabled || (block >= blocks()) || (section >= sections(block)))
+    {
+        return;
+    }
+
+    auto& descriptor = SysExConf::section(block, section);
+
+    if (index < descriptor.numberOfParameters)
+    {
+        uncacheValues(descriptor.offset + index, 1);
+    }
+}
+
+///
+/// \brief Enables or disables tracking of changed parameters.
+/// When enabled, parameters successfully set using the protocol or reported
+/// with notifyChanged are marked as changed and can be retrieved with get
+/// request using amount_t::CHANGED until the host acknowledges them with
+/// checkpoint request. Initially, no parameter is marked as changed.
+/// @param [in] state   New tracking state.
+/// \returns True on success, false otherwise (tracking can't be enabled without layout).
+///
+bool SysExConf::setDirtyTracking(bool state)
+{
+    if (state && !blocks())
+    {
+        return false;
+    }
+
+    _dirtyTrackingEnabled = state;
+    resizeDirtyTracking();
+
+    return true;
+}
+
+///
+/// \brief Marks parameter changed outside of the protocol as changed.
+/// Cached value of the parameter is invalidated as well.
+/// @param [in] block   Block index.
+/// @param [in] section Section index.
+/// @param [in] index   Parameter index.
+///
+void SysExConf::notifyChanged(uint8_t block, uint8_t section, uint16_t index)
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    invalidateCache(block, section, index);
+
+    if (!_dirtyTrackingEnabled || (block >= blocks()) || (section >= sections(block)))
+    {
+        return;
+    }
+
+    auto& descriptor = SysExConf::section(block, section);
+
+    if (index < descriptor.numberOfParameters)
+    {
+        markChanged(descriptor.offset + index, 1);
+    }
+}
+
+///
+/// \brief Clears all parameters which have been reported as changed.
+/// Parameters changed after they were reported are kept.
+///
+void SysExConf::checkpoint()
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    std::fill(_reported.begin(), _reported.end(), 0);
+}
+
+///
+/// \brief Enables or disables write-behind mode.
+/// When enabled, validated set requests are acknowledged immediately and the values
+/// are kept in RAM, so that repeated writes to the same parameter are coalesced.
+/// Deferred values are passed to the data handler, sorted and in consecutive ranges,
+/// on connection close, once no new value has been deferred for idle time (see update)
+/// or on explicit flush. When journal size is non-zero, every deferred write is also
+/// passed to DataHandler::appendJournal so it can be recovered with replayJournal,
+/// and the values are flushed once the journal is full.
+/// Deferred values are flushed before write-behind is disabled.
+/// @param [in] state       New write-behind state.
+/// @param [in] idleTime    Time without new writes after which values are flushed in update.
+///                         Set to 0 to disable idle flushing.
+/// @param [in] journalSize Maximum number of journal entries. Set to 0 to disable the journal.
+/// \returns True on success, false otherwise (write-behind can't be enabled without layout,
+///          or deferred values couldn't be flushed when disabling it).
+///
+bool SysExConf::setWriteBehind(bool state, uint32_t idleTime, uint16_t journalSize)
+{
+    if (state && !blocks())
+    {
+        return false;
+    }
+
+    if (!flush())
+    {
+        return false;
+    }
+
+    _writeBehindEnabled  = state;
+    _writeBehindIdleTime = idleTime;
+    _journalSize         = state ? journalSize : 0;
+    resizeWriteBehind();
+
+    return true;
+}
+
+///
+/// \brief Passes all deferred values to data handler.
+/// Values are passed with one setRange call per range of consecutive parameters.
+/// Journal is cleared only once all values are stored.
+/// \returns True on success, false otherwise (values which couldn't be stored remain deferred).
+///
+bool SysExConf::flush()
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    bool success = true;
+
+    for (uint8_t block = 0; _pendingWrites && (block < blocks()); block++)
+    {
+        for (uint8_t sectionIndex = 0; sectionIndex < sections(block); sectionIndex++)
+        {
+            auto&    descriptor = section(block, sectionIndex);
+            uint16_t index      = 0;
+
+            while (index < descriptor.numberOfParameters)
+            {
+                uint32_t first = descriptor.offset + index;
+
+                if (!(first % 32) && !_pending[first / 32])
+                {
+                    index += 32;
+                    continue;
+                }
+
+                if (!isPending(first))
+                {
+                    index++;
+                    continue;
+                }
+
+                uint16_t count = 1;
+
+                while (((index + count) < descriptor.numberOfParameters) && isPending(first + count))
+                {
+                    count++;
+                }
+
+                uint8_t result = _dataHandler.setRange(block, sectionIndex, index, count, &_pendingValues[first]);
+
+                if (result == static_cast<uint8_t>(status_t::ACK))
+                {
+                    for (uint16_t i = 0; i < count; i++)
+                    {
+                        _pending[(first + i) / 32] &= ~(1UL << ((first + i) % 32));
+                    }
+                }
+                else
+                {
+                    if (_cacheEnabled)
+                    {
+                        // state of the storage is unknown after failed write
+                        uncacheValues(first, count);
+                    }
+
+                    success = false;
+                }
+
+                index += count;
+            }
+        }
+    }
+
+    if (!success)
+    {
+        return false;
+    }
+
+    _pendingWrites = false;
+
+    if (_journalEntries)
+    {
+        _dataHandler.clearJournal();
+        _journalEntries = 0;
+    }
+
+    return true;
+}
+
+///
+/// \brief Flushes deferred values once no new value has been deferred for configured idle time.
+/// Should be called periodically when idle flushing is used.
+/// @param [in] currentTime Current time in the same unit as idle time passed to setWriteBehind.
+///
+void SysExConf::update(uint32_t currentTime)
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    if (!_writeBehindEnabled || !_writeBehindIdleTime || !_pendingWrites)
+    {
+        return;
+    }
+
+    if (_deferredSinceUpdate)
+    {
+        _deferredSinceUpdate = false;
+        _lastWriteTime       = currentTime;
+        return;
+    }
+
+    if ((currentTime - _lastWriteTime) >= _writeBehindIdleTime)
+    {
+        if (!flush())
+        {
+            // retry once idle time passes again
+            _lastWriteTime = currentTime;
+        }
+    }
+}
+
+///
+/// \brief Stores values recovered from journal after power loss using data handler.
+/// Should be called before any request is processed. Entries are stored in the order
+/// in which they're specified, and entries which don't fit the layout are skipped.
+/// Journal is cleared once all entries are stored.
+/// @param [in] entries Array with journal entries.
+/// @param [in] count   Number of journal entries.
+/// \returns True on success, false otherwise (no layout or handler error for any of the entries).
+///
+bool SysExConf::replayJournal(const JournalEntry* entries, uint16_t count)
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    if (!blocks())
+    {
+        return false;
+    }
+
+    bool success = true;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        auto& entry = entries[i];
+
+        if ((entry.block >= blocks()) || (entry.section >= sections(entry.block)))
+        {
+            continue;
+        }
+
+        auto& descriptor = section(entry.block, entry.section);
+
+        if (entry.index >= descriptor.numberOfParameters)
+        {
+            continue;
+        }
+
+        if (!descriptor.noRangeCheck && ((entry.value < descriptor.newValueMin) || (entry.value > descriptor.newValueMax)))
+        {
+            continue;
+        }
+
+        if (_dataHandler.set(entry.block, entry.section, entry.index, entry.value) != static_cast<uint8_t>(status_t::ACK))
+        {
+            success = false;
+        }
+
+        notifyChanged(entry.block, entry.section, entry.index);
+    }
+
+    if (success)
+    {
+        _dataHandler.clearJournal();
+    }
+
+    return success;
+}
+
+///
+/// \brief Enables or disables staged writes.
+/// When enabled, set requests for all parameters in sections with multiple parts
+/// are validated and buffered as the parts arrive and are stored with single handler
+/// call once all parts of the section have been received. Response to the last part
+/// contains the result of storing whole section. If any part is rejected, or the connection
+/// is closed or reconfigured, staged values are discarded without being stored. Each session
+/// stages its own section, and part for other section discards values staged for the previous
+/// one. Values stored meanwhile by other requests are merged into staged values, so that they
+/// aren't overwritten by older values once the section is stored.
+/// @param [in] state   New staging state.
+/// \returns True on success, false otherwise (staging can't be enabled without layout).
+///
+bool SysExConf::setStagedWrites(bool state)
+{
+    if (state && !blocks())
+    {
+        return false;
+    }
+
+    _stagedWritesEnabled = state;
+    clearStaging();
+
+    return true;
+}
+
+///
+/// \brief Retrieves number of parameters per message used in current session.
+/// \returns Number of parameters per message.
+///
+uint16_t SysExConf::paramsPerMessage() const
+{
+    return session()._paramsPerMessage;
+}
+
+///
+/// \brief Retrieves encoding of values for all parameters used in current session.
+/// \returns Encoding of values.
+///
+compression_t SysExConf::compression() const
+{
+    return session()._compression;
+}
+
+///
+/// \brief Retrieves data for specified section.
+/// @param [in] blockIndex      Block in which the section is located.
+/// @param [in] sectionIndex    Section index within the block.
+/// \returns Structure holding section data.
+///
+const SectionDescriptor& SysExConf::section(uint8_t blockIndex, uint8_t sectionIndex) const
+{
+    return _sections[_blocks[blockIndex].firstSection + sectionIndex];
+}
+
+///
+/// \brief Retrieves number of message parts needed to transfer all parameters
+/// in section with number of parameters per message used in current session.
+/// @param [in] descriptor  Section data.
+/// \returns Number of message parts.
+///
+uint8_t SysExConf::parts(const SectionDescriptor& descriptor) const
+{
+    if (session()._paramsPerMessage == PARAMS_PER_MESSAGE)
+    {
+        return descriptor.parts;
+    }
+
+    return (descriptor.numberOfParameters + session()._paramsPerMessage - 1) / session()._paramsPerMessage;
+}
+
+///
+/// \brief Retrieves number of parameters in last message part of the section
+/// with number of parameters per message used in current session.
+/// @param [in] descriptor  Section data.
+/// \returns Number of parameters in last message part.
+///
+uint16_t SysExConf::lastPartParameters(const SectionDescriptor& descriptor) const
+{
+    if (session()._paramsPerMessage == PARAMS_PER_MESSAGE)
+    {
+        return descriptor.lastPartParameters;
+    }
+
+    uint8_t sectionParts = parts(descriptor);
+
+    return sectionParts ? descriptor.numberOfParameters - ((sectionParts - 1) * session()._paramsPerMessage) : 0;
+}
+
+///
+/// \brief Allocates shadow value cache for current layout, or releases it if cache is disabled.
+/// All values are invalid afterwards.
+///
+void SysExConf::resizeCache()
+{
+    if (!_cacheEnabled)
+    {
+        _cache.clear();
+        _cache.shrink_to_fit();
+        _cacheValid.clear();
+        _cacheValid.shrink_to_fit();
+        return;
+    }
+
+    _cache.assign(parameters(), 0);
+    _cacheValid.assign((parameters() + 31) / 32, 0);
+}
+
+///
+/// \brief Checks whether the value at specified position in cache is valid.
+/// @param [in] position    Position of the value among all parameters in layout.
+/// \returns True if valid, false otherwise.
+///
+bool SysExConf::isCached(uint32_t position) const
+{
+    return (_cacheValid[position / 32] >> (position % 32)) & 0x01;
+}
+
+///
+/// \brief Stores values in cache and marks them as valid.
+/// @param [in] position    Position of the first value among all parameters in layout.
+/// @param [in] count       Number of values to store.
+/// @param [in] values      Array with values to store.
+///
+void SysExConf::cacheValues(uint32_t position, uint16_t count, const uint16_t* values)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        _cache[position + i] = values[i];
+        _cacheValid[(position + i) / 32] |= (1UL << ((position + i) % 32));
+    }
+}
+
+///
+/// \brief Marks values in cache as invalid.
+/// @param [in] position    Position of the first value among all parameters in layout.
+/// @param [in] count       Number of values to invalidate.
+///
+void SysExConf::uncacheValues(uint32_t position, uint32_t count)
+{
+#ifdef SYS_EX_CONF_THREAD_SAFE
+    _cacheGeneration++;
+#endif
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        _cacheValid[(position + i) / 32] &= ~(1UL << ((position + i) % 32));
+    }
+}
+
+///
+/// \brief Retrieves position of parameter from current section among all parameters in layout.
+/// @param [in] index   Parameter index.
+/// \returns Parameter position.
+///
+uint32_t SysExConf::position(uint16_t index) const
+{
+    return section(session()._decodedMessage.block, session()._decodedMessage.section).offset + index;
+}
+
+///
+/// \brief Allocates change tracking bitmaps for current layout, or releases them if tracking is disabled.
+///
+void SysExConf::resizeDirtyTracking()
+{
+    if (!_dirtyTrackingEnabled)
+    {
+        _dirty.clear();
+        _dirty.shrink_to_fit();
+        _reported.clear();
+        _reported.shrink_to_fit();
+        return;
+    }
+
+    _dirty.assign((parameters() + 31) / 32, 0);
+    _reported.assign((parameters() + 31) / 32, 0);
+}
+
+///
+/// \brief Marks parameters as changed.
+/// @param [in] position    Position of the first parameter among all parameters in layout.
+/// @param [in] count       Number of parameters to mark.
+///
+void SysExConf::markChanged(uint32_t position, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        _dirty[(position + i) / 32] |= (1UL << ((position + i) % 32));
+    }
+}
+
+///
+/// \brief Checks whether the parameter has been changed since last checkpoint.
+/// @param [in] position    Position of the parameter among all parameters in layout.
+/// \returns True if changed, false otherwise.
+///
+bool SysExConf::isChanged(uint32_t position) const
+{
+    return ((_dirty[position / 32] | _reported[position / 32]) >> (position % 32)) & 0x01;
+}
+
+///
+/// \brief Finds next changed parameter in section.
+/// Words without any changed parameter are skipped as a whole.
+/// @param [in] descriptor  Section data.
+/// @param [in] index       Index from which to start the search.
+/// \returns Index of the next changed parameter, or number of parameters in section if there isn't any.
+///
+uint16_t SysExConf::nextChanged(const SectionDescriptor& descriptor, uint16_t index) const
+{
+    while (index < descriptor.numberOfParameters)
+    {
+        uint32_t position = descriptor.offset + index;
+
+        if (!(position % 32) && !(_dirty[position / 32] | _reported[position / 32]))
+        {
+            index += 32;
+            continue;
+        }
+
+        if (isChanged(position))
+        {
+            return index;
+        }
+
+        index++;
+    }
+
+    return descriptor.numberOfParameters;
+}
+
+///
+/// \brief Marks changed parameter as reported to the host.
+/// @param [in] position    Position of the parameter among all parameters in layout.
+///
+void SysExConf::markReported(uint32_t position)
+{
+    _dirty[position / 32] &= ~(1UL << (position % 32));
+    _reported[position / 32] |= (1UL << (position % 32));
+}
+
+///
+/// \brief Allocates deferred value storage for current layout, or releases it if write-behind is disabled.
+/// All deferred values are discarded.
+///
+void SysExConf::resizeWriteBehind()
+{
+    _pendingWrites       = false;
+    _deferredSinceUpdate = false;
+
+    if (!_writeBehindEnabled)
+    {
+        _pendingValues.clear();
+        _pendingValues.shrink_to_fit();
+        _pending.clear();
+        _pending.shrink_to_fit();
+        return;
+    }
+
+    _pendingValues.assign(parameters(), 0);
+    _pending.assign((parameters() + 31) / 32, 0);
+}
+
+///
+/// \brief Checks whether the parameter has deferred value.
+/// @param [in] position    Position of the parameter among all parameters in layout.
+/// \returns True if deferred, false otherwise.
+///
+bool SysExConf::isPending(uint32_t position) const
+{
+    return (_pending[position / 32] >> (position % 32)) & 0x01;
+}
+
+///
+/// \brief Defers writing of multiple consecutive values in current section.
+/// Values are stored using data handler immediately if they can't be journaled.
+/// @param [in] startIndex  Index of first parameter to store.
+/// @param [in] count       Number of parameters to store.
+/// @param [in] values      Array with values to store.
+/// \returns status_t::ACK on success, error status otherwise.
+///
+uint8_t SysExConf::deferWrites(uint16_t startIndex, uint16_t count, const uint16_t* values)
+{
+    uint8_t block   = session()._decodedMessage.block;
+    uint8_t section = session()._decodedMessage.section;
+
+    if (_journalSize)
+    {
+        // make room for new entries
+        if (((_journalEntries + count) > _journalSize) && !flush())
+        {
+            return static_cast<uint8_t>(status_t::ERROR_WRITE);
+        }
+
+        bool journaled = count <= _journalSize;
+
+        for (uint16_t i = 0; journaled && (i < count); i++)
+        {
+            JournalEntry entry = {};
+
+            entry.block   = block;
+            entry.section = section;
+            entry.index   = startIndex + i;
+            entry.value   = values[i];
+
+            journaled = _dataHandler.appendJournal(entry);
+
+            if (journaled)
+            {
+                _journalEntries++;
+            }
+        }
+
+        if (!journaled)
+        {
+            // write directly only once older values are stored so that they can't
+            // overwrite the new ones on flush or journal replay
+            if (!flush())
+            {
+                return static_cast<uint8_t>(status_t::ERROR_WRITE);
+            }
+
+            return _dataHandler.setRange(block, section, startIndex, count, values);
+        }
+    }
+
+    uint32_t first = position(startIndex);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        _pendingValues[first + i] = values[i];
+        _pending[(first + i) / 32] |= (1UL << ((first + i) % 32));
+    }
+
+    _pendingWrites       = true;
+    _deferredSinceUpdate = true;
+
+    return static_cast<uint8_t>(status_t::ACK);
+}
+
+///
+/// \brief Discards values staged by all sessions and releases their buffers.
+/// If staged writes are enabled, single stage is preallocated for the largest section
+/// in current layout, so that requests on single session don't allocate memory.
+///
+void SysExConf::clearStaging()
+{
+    [[maybe_unused]] auto lock = lockState();
+
+    _stages.clear();
+
+    if (!_stagedWritesEnabled)
+    {
+        return;
+    }
+
+    uint16_t largest = 0;
+
+    for (uint8_t block = 0; block < blocks(); block++)
+    {
+        for (uint8_t sectionIndex = 0; sectionIndex < sections(block); sectionIndex++)
+        {
+            largest = std::max(largest, section(block, sectionIndex).numberOfParameters);
+        }
+    }
+
+    _stages.emplace_back();
+    _stages.back().values.reserve(largest);
+}
+
+///
+/// \brief Checks whether set request for all parameters in current section is staged.
+/// \returns True if staged writes are enabled and the section has multiple parts, false otherwise.
+///
+bool SysExConf::stagesSection() const
+{
+    return _stagedWritesEnabled && (parts(section(session()._decodedMessage.block, session()._decodedMessage.section)) > 1);
+}
+
+///
+/// \brief Retrieves stage used by the session.
+/// @param [in] owner   Session whose stage should be retrieved, nullptr to retrieve unused stage.
+/// \returns Pointer to the stage or nullptr if there is no such stage.
+///
+SysExConf::Stage* SysExConf::findStage(const Session* owner)
+{
+    for (auto& stage : _stages)
+    {
+        if (stage.session == owner)
+        {
+            return &stage;
+        }
+    }
+
+    return nullptr;
+}
+
+///
+/// \brief Buffers values from single part of set request for all parameters in current section.
+/// Part for a section other than the one staged by current session starts staging from scratch.
+/// Should be called with the state lock held.
+/// @param [in] startIndex  Index of first parameter in part.
+/// @param [in] count       Number of parameters in part.
+/// @param [in] values      Array with validated values.
+/// \returns Staged values of whole section once all of its parts have been staged, nullptr otherwise.
+///           Values remain valid until discardStaged is called for current session.
+///
+const uint16_t* SysExConf::stageValues(uint16_t startIndex, uint16_t count, const uint16_t* values)
+{
+    uint8_t block   = session()._decodedMessage.block;
+    uint8_t section = session()._decodedMessage.section;
+    auto*   stage   = findStage(&session());
+
+    if ((stage != nullptr) && ((stage->block != block) || (stage->section != section)))
+    {
+        // host has moved on to other section
+        stage->session = nullptr;
+        stage          = nullptr;
+    }
+
+    if (stage == nullptr)
+    {
+        // stages released by any session are reused before new one is allocated
+        stage = findStage(nullptr);
+
+        if (stage == nullptr)
+        {
+            stage = &_stages.emplace_back();
+        }
+
+        stage->session   = &session();
+        stage->block     = block;
+        stage->section   = section;
+        stage->partCount = 0;
+        stage->parts.fill(0);
+        stage->values.resize(SysExConf::section(block, section).numberOfParameters);
+    }
+
+    std::copy(values, values + count, &stage->values[startIndex]);
+
+    uint8_t part = session()._decodedMessage.part;
+
+    if (!((stage->parts[part / 32] >> (part % 32)) & 0x01))
+    {
+        stage->parts[part / 32] |= (1UL << (part % 32));
+        stage->partCount++;
+    }
+
+    if (stage->partCount != parts(SysExConf::section(block, section)))
+    {
+        return nullptr;
+    }
+
+    // values being stored aren't updated anymore
+    stage->committing = true;
+
+    return stage->values.data();
+}
+
+///
+/// \brief Copies stored values of current section into values staged for it by all sessions.
+/// Should be called with the state lock held.
+/// @param [in] startIndex  Index of first stored parameter.
+/// @param [in] count       Number of stored parameters.
+/// @param [in] values      Array with stored values.
+///
+void SysExConf::mergeStaged(uint16_t startIndex, uint16_t count, const uint16_t* values)
+{
+    for (auto& stage : _stages)
+    {
+        if ((stage.session == nullptr) || stage.committing || (stage.block != session()._decodedMessage.block) || (stage.section != session()._decodedMessage.section))
+        {
+            continue;
+        }
+
+        std::copy(values, values + count, &stage.values[startIndex]);
+    }
+}
+
+///
+/// \brief Discards values staged by the session.
+/// Values staged by other sessions are kept.
+/// @param [in] owner   Session whose values should be discarded.
+///
+void SysExConf::discardStaged(const Session& owner)
+{
+    [[maybe_unused]] auto lock  = lockState();
+    auto*                 stage = findStage(&owner);
+
+    if (stage != nullptr)
+    {
+        stage->session    = nullptr;
+        stage->committing = false;
+    }
+}
+
+#ifdef SYS_EX_CONF_STATS
+///
+/// \brief Configures function used to measure latency of handled requests.
+/// @param [in] clock   Function returning current time. Set to nullptr to stop measuring latency.
+///
+void SysExConf::setStatsClock(statsClock_t clock)
+{
+    _statsClock = clock;
+}
+
+///
+/// \brief Retrieves current values of all counters.
+/// Counters are read one by one, so the snapshot isn't atomic as a whole.
+/// \returns Snapshot of all counters.
+///
+Stats SysExConf::stats() const
+{
+    uint32_t values[STATS_COUNTERS];
+    Stats    snapshot;
+
+    for (size_t i = 0; i < STATS_COUNTERS; i++)
+    {
+        values[i] = _stats[i].load(std::memory_order_relaxed);
+    }
+
+    std::memcpy(&snapshot, values, sizeof(snapshot));
+
+    return snapshot;
+}
+
+///
+/// \brief Clears all counters.
+///
+void SysExConf::resetStats()
+{
+    for (auto& counter : _stats)
+    {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+///
+/// \brief Increments single counter.
+/// @param [in] offset  Offset of the counter within Stats structure.
+/// @param [in] index   Index of the counter within array located at specified offset.
+///
+void SysExConf::countStat(size_t offset, size_t index)
+{
+    _stats[(offset / sizeof(uint32_t)) + index].fetch_add(1, std::memory_order_relaxed);
+}
+
+///
+/// \brief Retrieves current time from configured clock.
+/// \returns Current time, or 0 if clock isn't configured.
+///
+uint32_t SysExConf::statsTime() const
+{
+    return _statsClock ? _statsClock() : 0;
+}
+
+///
+/// \brief Updates request and latency counters once the request has been handled.
+/// @param [in] wish        Wish byte of the request.
+/// @param [in] amount      Amount byte of the request.
+/// @param [in] special     Flag indicating whether or not the request is special one.
+/// @param [in] startTime   Time at which request handling has started.
+///
+void SysExConf::recordRequest(uint8_t wish, uint8_t amount, bool special, uint32_t startTime)
+{
+    uint8_t bucket  = 0;
+    uint8_t status  = std::min(session()._statsStatus, STATS_STATUS_OTHER);
+    uint8_t amounts = 0;
+
+    if (_statsClock)
+    {
+        uint32_t elapsed = _statsClock() - startTime;
+
+        while (elapsed && (bucket < (STATS_LATENCY_BUCKETS - 1)))
+        {
+            elapsed >>= 1;
+            bucket++;
+        }
+    }
+
+    countStat(offsetof(Stats, statuses), status);
+
+    if (_statsClock)
+    {
+        countStat(offsetof(Stats, statusLatency), (status * STATS_LATENCY_BUCKETS) + bucket);
+    }
+
+    if (special)
+    {
+        countStat(offsetof(Stats, specialRequests));
+
+        if (_statsClock)
+        {
+            countStat(offsetof(Stats, specialLatency), bucket);
+        }
+
+        return;
+    }
+
+    switch (static_cast<amount_t>(amount))
+    {
+    case amount_t::SINGLE:
+    case amount_t::ALL:
+    {
+        amounts = amount;
+    }
+    break;
+
+    case amount_t::CHANGED:
+    {
+        amounts = STATS_AMOUNTS - 1;
+    }
+    break;
+
+    default:
+        return;    // invalid requests are counted only by status
+    }
+
+    if (wish >= STATS_WISHES)
+    {
+        return;
+    }
+
+    countStat(offsetof(Stats, requests), (wish * STATS_AMOUNTS) + amounts);
+
+    if (_statsClock)
+    {
+        countStat(offsetof(Stats, latency), (((wish * STATS_AMOUNTS) + amounts) * STATS_LATENCY_BUCKETS) + bucket);
+    }
+}
+
+///
+/// \brief Updates response counters with the response which is about to be sent.
+///
+void SysExConf::recordResponse()
+{
+    session()._statsStatus = session()._response[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)];
+
+    countStat(offsetof(Stats, responses));
+    _stats[offsetof(Stats, responseBytes) / sizeof(uint32_t)].fetch_add(session()._responseCounter, std::memory_order_relaxed);
+}
+
+///
+/// \brief Appends counters to the response, starting from the counter specified in the request.
+/// Response contains total number of counters, followed by as many counters as fit into the response,
+/// each one sent as three values holding bits 28-31, 14-27 and 0-13.
+/// @param [in] receivedArray       Request array.
+/// @param [in] receivedArraySize   Request array size.
+///
+void SysExConf::processStatsRequest(const uint8_t* receivedArray, uint16_t receivedArraySize)
+{
+    constexpr uint8_t VALUES_PER_COUNTER = 3;
+
+    uint16_t first = 0;
+
+    if (receivedArraySize == SPECIAL_REQ_VALUE_MSG_SIZE)
+    {
+        first = Merge14Bit(receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1], receivedArray[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2]).value();
+    }
+
+    if (first >= STATS_COUNTERS)
+    {
+        setStatus(status_t::ERROR_NEW_VALUE);
+        return;
+    }
+
+    setStatus(status_t::ACK);
+    addToResponse(STATS_COUNTERS);
+
+    for (size_t i = first; i < STATS_COUNTERS; i++)
+    {
+        // keep space for 0xF7
+        if ((session()._responseCounter + (VALUES_PER_COUNTER * BYTES_PER_VALUE)) >= MAX_MESSAGE_SIZE)
+        {
+            break;
+        }
+
+        uint32_t value = _stats[i].load(std::memory_order_relaxed);
+
+        addToResponse((value >> 28) & 0x0F);
+        addToResponse((value >> 14) & 0x3FFF);
+        addToResponse(value & 0x3FFF);
+    }
+}
+#endif
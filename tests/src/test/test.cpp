@@ -1,5 +1,12 @@
 #include "tests/common.h"
 #include "lib/sysexconf/sysexconf.h"
+#include "lib/sysexconf/client.h"
+#include "lib/sysexconf/async.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #define SYS_EX_CONF_M_ID_0              0x00
 #define SYS_EX_CONF_M_ID_1              0x53
@@ -38,6 +45,31 @@ using namespace lib::sysexconf;
 
 namespace
 {
+    constexpr StaticLayout<3> STATIC_LAYOUT({
+        Section(SECTION_0_PARAMETERS, SECTION_0_MIN, SECTION_0_MAX),
+        Section(SECTION_1_PARAMETERS, SECTION_1_MIN, SECTION_1_MAX),
+        Section(SECTION_2_PARAMETERS, SECTION_2_MIN, SECTION_2_MAX),
+    });
+
+    static_assert(STATIC_LAYOUT.valid());
+    static_assert(STATIC_LAYOUT.sections()[TEST_SECTION_MULTIPLE_PARTS_ID].parts == 2);
+    static_assert(STATIC_LAYOUT.sections()[TEST_SECTION_MULTIPLE_PARTS_ID].lastPartParameters == 1);
+    static_assert(STATIC_LAYOUT.sections()[TEST_SECTION_NOMINMAX].noRangeCheck);
+
+    // section with more parameters than it can be addressed with 126 parts
+    constexpr StaticLayout<1> STATIC_LAYOUT_INVALID({
+        Section((MAX_PARTS * PARAMS_PER_MESSAGE) + 1, 0, 0),
+    });
+
+    static_assert(!STATIC_LAYOUT_INVALID.valid());
+
+    // number of parts which wraps around when stored in single byte
+    constexpr StaticLayout<1> STATIC_LAYOUT_WRAPPED({
+        Section(256 * PARAMS_PER_MESSAGE, 0, 0),
+    });
+
+    static_assert(!STATIC_LAYOUT_WRAPPED.valid());
+
     class SysExTest : public ::testing::Test
     {
         protected:
@@ -107,6 +139,7 @@ namespace
 
             uint8_t get(uint8_t block, uint8_t section, uint16_t index, uint16_t& value) override
             {
+                getCalls++;
                 value = TEST_VALUE_GET;
 
                 if (getResults.empty())
@@ -122,6 +155,8 @@ namespace
 
             uint8_t set(uint8_t block, uint8_t section, uint16_t index, uint16_t newValue) override
             {
+                setCalls++;
+
                 if (setResults.empty())
                 {
                     return static_cast<uint8_t>(status_t::ACK);
@@ -133,6 +168,36 @@ namespace
                 return retVal;
             }
 
+            uint8_t getRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, uint16_t* values) override
+            {
+                getRangeCalls++;
+                return DataHandler::getRange(block, section, startIndex, count, values);
+            }
+
+            uint8_t setRange(uint8_t block, uint8_t section, uint16_t startIndex, uint16_t count, const uint16_t* values) override
+            {
+                setRangeCalls++;
+                setRangeValues.assign(values, values + count);
+
+                return DataHandler::setRange(block, section, startIndex, count, values);
+            }
+
+            bool appendJournal(const JournalEntry& entry) override
+            {
+                if (!journal)
+                {
+                    return false;
+                }
+
+                journalEntries.push_back(entry);
+                return true;
+            }
+
+            void clearJournal() override
+            {
+                journalEntries.clear();
+            }
+
             uint8_t customRequest(uint16_t request, CustomResponse& customResponse) override
             {
                 switch (request)
@@ -161,6 +226,13 @@ namespace
                 _response.clear();
                 getResults.clear();
                 setResults.clear();
+                usbMidiResponse.clear();
+                getCalls      = 0;
+                getRangeCalls = 0;
+                setCalls      = 0;
+                setRangeCalls = 0;
+                setRangeValues.clear();
+                responsePorts.clear();
             }
 
             size_t responseCounter()
@@ -188,10 +260,71 @@ namespace
                 }
 
                 _response.push_back(tempResponse);
+
+                if (sysEx != nullptr)
+                {
+                    responsePorts.push_back(sysEx->port());
+                }
+            }
+
+            bool sendUsbMidiResponse(uint8_t* packets, uint16_t size) override
+            {
+                if (!usbMidi)
+                {
+                    return false;
+                }
+
+                std::vector<uint8_t> tempResponse;
+
+                usbMidiResponse.clear();
+
+                for (uint16_t i = 0; i < size; i++)
+                {
+                    usbMidiResponse.push_back(packets[i]);
+                }
+
+                // unpack the response as well so that it can be verified like any other response
+                for (uint16_t i = 0; i < size; i += USB_MIDI_PACKET_SIZE)
+                {
+                    uint8_t bytes = 3;
+
+                    switch (static_cast<usbMidiCin_t>(packets[i] & 0x0F))
+                    {
+                    case usbMidiCin_t::SYS_EX_END_1BYTE:
+                        bytes = 1;
+                        break;
+
+                    case usbMidiCin_t::SYS_EX_END_2BYTE:
+                        bytes = 2;
+                        break;
+
+                    default:
+                        break;
+                    }
+
+                    for (uint8_t j = 0; j < bytes; j++)
+                    {
+                        tempResponse.push_back(packets[i + 1 + j]);
+                    }
+                }
+
+                _response.push_back(tempResponse);
+                return true;
             }
 
-            std::vector<uint8_t> getResults = {};
-            std::vector<uint8_t> setResults = {};
+            std::vector<uint8_t>      getResults      = {};
+            std::vector<uint8_t>      setResults      = {};
+            std::vector<uint8_t>      usbMidiResponse = {};
+            bool                      usbMidi         = false;
+            size_t                    getCalls        = 0;
+            size_t                    getRangeCalls   = 0;
+            size_t                    setCalls        = 0;
+            size_t                    setRangeCalls   = 0;
+            std::vector<uint16_t>     setRangeValues  = {};
+            bool                      journal         = false;
+            std::vector<JournalEntry> journalEntries  = {};
+            const SysExConf*          sysEx           = nullptr;
+            std::vector<uint8_t>      responsePorts   = {};
 
             private:
             std::vector<std::vector<uint8_t>> _response;
@@ -241,6 +374,33 @@ namespace
             sysEx.handleMessage(&source[0], source.size());
         }
 
+        std::vector<uint8_t> usbMidiPackets(const std::vector<uint8_t>& source, uint8_t cable)
+        {
+            std::vector<uint8_t> packets;
+
+            for (size_t i = 0; i < source.size(); i += 3)
+            {
+                size_t remaining = source.size() - i;
+
+                if (remaining > 3)
+                {
+                    packets.push_back((cable << 4) | static_cast<uint8_t>(usbMidiCin_t::SYS_EX_START));
+                    remaining = 3;
+                }
+                else
+                {
+                    packets.push_back((cable << 4) | (static_cast<uint8_t>(usbMidiCin_t::SYS_EX_END_1BYTE) + remaining - 1));
+                }
+
+                for (size_t j = 0; j < 3; j++)
+                {
+                    packets.push_back(j < remaining ? source.at(i + j) : 0);
+                }
+            }
+
+            return packets;
+        }
+
         void openConn()
         {
             // send open connection request
@@ -636,6 +796,31 @@ namespace
             0xF7
         };
 
+        const std::vector<uint8_t> SET_SPECIAL_REQ_PARAM_PER_MSG = {
+            // built-in special request which sets number of parameters per message for current session
+            0xF0,
+            SYS_EX_CONF_M_ID_0,
+            SYS_EX_CONF_M_ID_1,
+            SYS_EX_CONF_M_ID_2,
+            0x00,
+            0x00,
+            0x03,
+            SYSEX_PARAM(64),
+            0xF7
+        };
+
+        const std::vector<uint8_t> GET_SPECIAL_REQ_MAX_PARAM_PER_MSG = {
+            // built-in special request which returns maximum number of parameters per message
+            0xF0,
+            SYS_EX_CONF_M_ID_0,
+            SYS_EX_CONF_M_ID_1,
+            SYS_EX_CONF_M_ID_2,
+            0x00,
+            0x00,
+            0x04,
+            0xF7
+        };
+
         const std::vector<uint8_t> SET_SINGLE_VALID = {
             // valid set singe command
             0xF0,
@@ -1886,4 +2071,2350 @@ TEST_F(SysExTest, SpecialRequest)
 
     // reset message count
     dataHandler.reset();
-}
\ No newline at end of file
+}
+
+TEST_F(SysExTest, Stream)
+{
+    // open connection by feeding the request byte by byte
+    for (size_t i = 0; i < CONN_OPEN.size(); i++)
+    {
+        sysEx.feedByte(CONN_OPEN.at(i));
+    }
+
+    ASSERT_TRUE(sysEx.isConfigurationEnabled());
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyMessage(CONN_OPEN, status_t::ACK);
+
+    dataHandler.reset();
+
+    // feed get single request with real time messages interleaved
+    for (size_t i = 0; i < GET_SINGLE_VALID.size(); i++)
+    {
+        sysEx.feedByte(GET_SINGLE_VALID.at(i));
+        sysEx.feedByte(0xF8);
+    }
+
+    const std::vector<uint8_t> DATA = {
+        SYSEX_PARAM(TEST_VALUE_GET)
+    };
+
+    // check response
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+
+    // check number of received messages
+    ASSERT_EQ(1, dataHandler.responseCounter());
+
+    // reset message count
+    dataHandler.reset();
+
+    // message with another manufacturer ID followed by valid message in same chunk
+    std::vector<uint8_t> stream = GET_SINGLE_INVALID_SYS_EX_ID;
+    stream.insert(stream.end(), SET_SINGLE_VALID.begin(), SET_SINGLE_VALID.end());
+
+    sysEx.feed(&stream[0], stream.size() / 2);
+    sysEx.feed(&stream[stream.size() / 2], stream.size() - (stream.size() / 2));
+
+    // only the message meant for this device should be answered
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyMessage(SET_SINGLE_VALID, status_t::ACK);
+
+    // reset message count
+    dataHandler.reset();
+
+    // message interrupted by another status byte should be dropped
+    sysEx.feed(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size() - 3);
+    sysEx.feedByte(0x90);
+    sysEx.feed(&GET_SINGLE_VALID[GET_SINGLE_VALID.size() - 3], 3);
+
+    ASSERT_EQ(0, dataHandler.responseCounter());
+
+    // message restarted with new start byte should be handled normally
+    sysEx.feed(&GET_SINGLE_VALID[0], 6);
+    sysEx.feed(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+
+    // reset message count
+    dataHandler.reset();
+
+    // custom message sent while request is being received doesn't affect it
+    std::vector<uint16_t> values = {
+        0x05,
+    };
+
+    sysEx.feed(&GET_SINGLE_VALID[0], 6);
+    sysEx.sendCustomMessage(&values[0], values.size());
+    sysEx.feed(&GET_SINGLE_VALID[6], GET_SINGLE_VALID.size() - 6);
+
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+}
+
+TEST_F(SysExTest, ForeignId)
+{
+    openConn();
+    dataHandler.reset();
+
+    const std::vector<uint8_t> DATA = {
+        SYSEX_PARAM(TEST_VALUE_GET)
+    };
+
+    // valid request for device with another manufacturer ID
+    auto foreign = SET_SINGLE_VALID;
+
+    foreign[static_cast<uint8_t>(byteOrder_t::ID_BYTE_1)]++;
+
+    const auto FOREIGN_COPY = foreign;
+
+    // frame is dropped without being copied over request which is being received in the meantime
+    sysEx.feed(&GET_SINGLE_VALID[0], 6);
+    handleMessage(foreign);
+
+    ASSERT_EQ(0, dataHandler.responseCounter());
+    ASSERT_EQ(0, dataHandler.setCalls);
+    ASSERT_EQ(FOREIGN_COPY, foreign);
+
+    sysEx.feed(&GET_SINGLE_VALID[6], GET_SINGLE_VALID.size() - 6);
+
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+}
+
+TEST_F(SysExTest, UsbMidi)
+{
+    openConn();
+
+    // handler doesn't send USB MIDI packets - standard response should be used
+    auto packets = usbMidiPackets(GET_SINGLE_VALID, 0);
+    sysEx.feedUsbMidi(&packets[0], packets.size());
+
+    const std::vector<uint8_t> DATA = {
+        SYSEX_PARAM(TEST_VALUE_GET)
+    };
+
+    // check response
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+    ASSERT_TRUE(dataHandler.usbMidiResponse.empty());
+
+    // check number of received messages
+    ASSERT_EQ(1, dataHandler.responseCounter());
+
+    // reset message count
+    dataHandler.reset();
+    dataHandler.usbMidi = true;
+
+    // now feed same request packet by packet on another cable
+    packets = usbMidiPackets(GET_SINGLE_VALID, 3);
+
+    for (size_t i = 0; i < packets.size(); i += USB_MIDI_PACKET_SIZE)
+    {
+        sysEx.feedUsbMidiPacket(&packets[i]);
+    }
+
+    // check response
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+
+    // check number of received messages
+    ASSERT_EQ(1, dataHandler.responseCounter());
+
+    // response should be packed on the same cable
+    std::vector<uint8_t> expected = dataHandler.response(0);
+    ASSERT_EQ(usbMidiPackets(expected, 3), dataHandler.usbMidiResponse);
+
+    // reset message count
+    dataHandler.reset();
+
+    // custom messages aren't tied to any request and are always sent as standard SysEx
+    std::vector<uint16_t> values = {
+        0x05,
+    };
+
+    sysEx.sendCustomMessage(&values[0], values.size());
+
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    ASSERT_TRUE(dataHandler.usbMidiResponse.empty());
+}
+
+TEST_F(SysExTest, StaticLayout)
+{
+    SysExConfStatic<STATIC_LAYOUT> sysExStatic(dataHandler, M_ID);
+
+    ASSERT_EQ(1, sysExStatic.blocks());
+    ASSERT_EQ(3, sysExStatic.sections(TEST_BLOCK_ID));
+
+    sysExStatic.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    ASSERT_TRUE(sysExStatic.isConfigurationEnabled());
+
+    // reset message count
+    dataHandler.reset();
+
+    // get all parts with final ack
+    sysExStatic.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+    ASSERT_EQ(3, dataHandler.responseCounter());
+
+    // reset message count
+    dataHandler.reset();
+
+    // set all for both parts of multi-part section
+    sysExStatic.handleMessage(&SET_ALL_MORE_PARTS1[0], SET_ALL_MORE_PARTS1.size());
+    verifyMessage(SET_ALL_MORE_PARTS1, status_t::ACK);
+
+    sysExStatic.handleMessage(&SET_ALL_MORE_PARTS2[0], SET_ALL_MORE_PARTS2.size());
+    verifyMessage(SET_ALL_MORE_PARTS2, status_t::ACK);
+
+    // value checks
+    sysExStatic.handleMessage(&SET_SINGLE_INVALID_NEW_VALUE[0], SET_SINGLE_INVALID_NEW_VALUE.size());
+    verifyMessage(SET_SINGLE_INVALID_NEW_VALUE, status_t::ERROR_NEW_VALUE);
+
+    sysExStatic.handleMessage(&SET_SINGLE_NO_MIN_MAX3[0], SET_SINGLE_NO_MIN_MAX3.size());
+    verifyMessage(SET_SINGLE_NO_MIN_MAX3, status_t::ACK);
+
+    // layout checks
+    sysExStatic.handleMessage(&ERROR_BLOCK[0], ERROR_BLOCK.size());
+    verifyMessage(ERROR_BLOCK, status_t::ERROR_BLOCK);
+
+    sysExStatic.handleMessage(&ERROR_SECTION[0], ERROR_SECTION.size());
+    verifyMessage(ERROR_SECTION, status_t::ERROR_SECTION);
+
+    sysExStatic.handleMessage(&ERROR_INDEX[0], ERROR_INDEX.size());
+    verifyMessage(ERROR_INDEX, status_t::ERROR_INDEX);
+
+    ASSERT_EQ(7, dataHandler.responseCounter());
+
+    // layout should be kept after reset
+    sysExStatic.reset();
+    ASSERT_EQ(1, sysExStatic.blocks());
+}
+
+TEST_F(SysExTest, LayoutValidation)
+{
+    // section which can't be transferred in 126 parts
+    std::vector<Section> largeSections = {
+        {
+            (MAX_PARTS * PARAMS_PER_MESSAGE) + 1,
+            0,
+            0,
+        }
+    };
+
+    std::vector<Block> largeLayout = {
+        {
+            largeSections,
+        }
+    };
+
+    ASSERT_FALSE(sysEx.setLayout(largeLayout));
+    ASSERT_EQ(0, sysEx.blocks());
+
+    // number of parts which wraps around when stored in single byte
+    std::vector<Section> wrappedSections = {
+        {
+            256 * PARAMS_PER_MESSAGE,
+            0,
+            0,
+        }
+    };
+
+    std::vector<Block> wrappedLayout = {
+        {
+            wrappedSections,
+        }
+    };
+
+    ASSERT_FALSE(sysEx.setLayout(wrappedLayout));
+    ASSERT_EQ(0, sysEx.blocks());
+
+    // more blocks than block byte can address
+    std::vector<Block> tooManyBlocks(MAX_BLOCKS + 1, Block(testSections));
+
+    ASSERT_FALSE(sysEx.setLayout(tooManyBlocks));
+    ASSERT_EQ(0, sysEx.blocks());
+
+    // messages are ignored without valid layout
+    handleMessage(CONN_OPEN);
+    ASSERT_EQ(0, dataHandler.responseCounter());
+
+    {
+        // layout is copied internally and isn't referenced once it's set
+        std::vector<Section> sections = {
+            {
+                SECTION_0_PARAMETERS,
+                SECTION_0_MIN,
+                SECTION_0_MAX,
+            }
+        };
+
+        std::vector<Block> layout = {
+            {
+                sections,
+            }
+        };
+
+        ASSERT_TRUE(sysEx.setLayout(layout));
+    }
+
+    ASSERT_EQ(1, sysEx.blocks());
+    ASSERT_EQ(1, sysEx.sections(TEST_BLOCK_ID));
+
+    openConn();
+
+    handleMessage(SET_SINGLE_INVALID_NEW_VALUE);
+    verifyMessage(SET_SINGLE_INVALID_NEW_VALUE, status_t::ERROR_NEW_VALUE);
+}
+
+TEST_F(SysExTest, Range)
+{
+    openConn();
+
+    // every part should be retrieved with single call
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    ASSERT_EQ(2, dataHandler.getRangeCalls);
+
+    // reset message count
+    dataHandler.reset();
+
+    // every part should be stored with single call
+    handleMessage(SET_ALL_MORE_PARTS1);
+    verifyMessage(SET_ALL_MORE_PARTS1, status_t::ACK);
+
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    ASSERT_EQ(PARAMS_PER_MESSAGE, dataHandler.setRangeValues.size());
+    ASSERT_EQ(0x01, dataHandler.setRangeValues.at(0));
+    ASSERT_EQ(0x19, dataHandler.setRangeValues.at(24));
+
+    // reset message count
+    dataHandler.reset();
+
+    // invalid values should be rejected before anything is stored
+    handleMessage(SET_ALLNVALID_NEW_VAL);
+    verifyMessage(SET_ALLNVALID_NEW_VAL, status_t::ERROR_NEW_VALUE);
+
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    // reset message count
+    dataHandler.reset();
+
+    // single values don't use range calls
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(SET_SINGLE_VALID);
+
+    ASSERT_EQ(0, dataHandler.getRangeCalls);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+}
+
+TEST_F(SysExTest, DirectHandler)
+{
+    class DirectDataHandler final : public SysExConfDataHandler
+    {
+    };
+
+    DirectDataHandler                  directHandler;
+    SysExConfDirect<DirectDataHandler> sysExDirect(directHandler, M_ID);
+
+    ASSERT_TRUE(sysExDirect.setLayout(sysExLayout));
+
+    sysExDirect.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    ASSERT_TRUE(sysExDirect.isConfigurationEnabled());
+
+    // get all parts with final ack
+    sysExDirect.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+
+    ASSERT_EQ(4, directHandler.responseCounter());
+    ASSERT_EQ(2, directHandler.getRangeCalls);
+    ASSERT_EQ(TEST_VALUE_GET, directHandler.response(1).at(static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + (2 * BYTES_PER_VALUE) + 1));
+
+    // set with range check
+    sysExDirect.handleMessage(&SET_ALLNVALID_NEW_VAL[0], SET_ALLNVALID_NEW_VAL.size());
+
+    ASSERT_EQ(5, directHandler.responseCounter());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ERROR_NEW_VALUE), directHandler.response(4).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+    ASSERT_EQ(0, directHandler.setRangeCalls);
+
+    // compile time layout combined with statically bound handler
+    SysExConfStatic<STATIC_LAYOUT, DirectDataHandler> sysExStatic(directHandler, M_ID);
+
+    directHandler.reset();
+
+    sysExStatic.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    sysExStatic.handleMessage(&SET_ALL_MORE_PARTS1[0], SET_ALL_MORE_PARTS1.size());
+
+    ASSERT_EQ(2, directHandler.responseCounter());
+    ASSERT_EQ(1, directHandler.setRangeCalls);
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ACK), directHandler.response(1).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+}
+
+TEST_F(SysExTest, CustomReqMinId)
+{
+    SysExConf sysExCustom(dataHandler, M_ID);
+
+    // IDs from 0x04 used to be available for custom requests, now they're taken by special requests
+    std::vector<CustomRequest> oldMinimum = {
+        {
+            .requestId     = 0x04,
+            .connOpenCheck = true,
+        },
+    };
+
+    ASSERT_FALSE(sysExCustom.setupCustomRequests(oldMinimum));
+
+    std::vector<CustomRequest> lastSpecial = {
+        {
+            .requestId     = CUSTOM_REQUEST_ID_MIN - 1,
+            .connOpenCheck = true,
+        },
+    };
+
+    ASSERT_FALSE(sysExCustom.setupCustomRequests(lastSpecial));
+
+    std::vector<CustomRequest> minimum = {
+        {
+            .requestId     = CUSTOM_REQUEST_ID_MIN,
+            .connOpenCheck = true,
+        },
+    };
+
+    ASSERT_TRUE(sysExCustom.setupCustomRequests(minimum));
+
+    // positions of requests are stored in single byte
+    const CustomRequest REQUEST = {
+        .requestId     = CUSTOM_REQUEST_ID_MIN,
+        .connOpenCheck = true,
+    };
+
+    std::vector<CustomRequest> tooMany(256, REQUEST);
+    std::vector<CustomRequest> maximum(255, REQUEST);
+
+    ASSERT_FALSE(sysExCustom.setupCustomRequests(tooMany));
+    ASSERT_TRUE(sysExCustom.setupCustomRequests(maximum));
+}
+
+TEST_F(SysExTest, CustomReqCallback)
+{
+    constexpr uint16_t CALLBACK_VALUE = CUSTOM_REQUEST_VALUE + 1;
+
+    openConn();
+
+    uint16_t receivedRequest = 0;
+
+    std::vector<CustomRequest> customRequestsCallback = {
+        {
+            .requestId     = CUSTOM_REQUEST_ID_VALID,
+            .connOpenCheck = true,
+            .handler       = [](void* context, uint16_t request, DataHandler::CustomResponse& customResponse)
+            {
+                *static_cast<uint16_t*>(context) = request;
+                customResponse.append(CALLBACK_VALUE);
+                return static_cast<uint8_t>(status_t::ACK);
+            },
+            .context       = &receivedRequest,
+        },
+
+        {
+            // handled by DataHandler::customRequest
+            .requestId     = CUSTOM_REQUEST_ID_NO_CONN_CHECK,
+            .connOpenCheck = false,
+        },
+
+        {
+            // duplicate ID, first definition should be used
+            .requestId     = CUSTOM_REQUEST_ID_VALID,
+            .connOpenCheck = true,
+        }
+    };
+
+    ASSERT_TRUE(sysEx.setupCustomRequests(customRequestsCallback));
+
+    handleMessage(CUSTOM_REQ);
+
+    std::vector<uint8_t> data = {
+        SYSEX_PARAM(CALLBACK_VALUE)
+    };
+
+    // check response
+    verifyMessage(CUSTOM_REQ, status_t::ACK, &data);
+    ASSERT_EQ(CUSTOM_REQUEST_ID_VALID, receivedRequest);
+
+    // reset message count
+    dataHandler.reset();
+
+    handleMessage(CUSTOM_REQ_NO_CONN_CHECK);
+
+    data = {
+        SYSEX_PARAM(CUSTOM_REQUEST_VALUE)
+    };
+
+    // check response
+    verifyMessage(CUSTOM_REQ_NO_CONN_CHECK, status_t::ACK, &data);
+
+    // reset message count
+    dataHandler.reset();
+
+    // previously configured requests shouldn't be available anymore
+    handleMessage(CUSTOM_REQ_ERROR_READ);
+
+    // check response
+    verifyMessage(CUSTOM_REQ_ERROR_READ, status_t::ERROR_WISH);
+
+    // check number of received messages
+    ASSERT_EQ(1, dataHandler.responseCounter());
+}
+
+TEST_F(SysExTest, ResponseRing)
+{
+    class RingDataHandler : public SysExConfDataHandler
+    {
+        public:
+        bool sendResponseSlot(uint8_t slot, uint8_t* array, uint16_t size) override
+        {
+            slots.push_back(slot);
+            sendResponse(array, size);
+            return true;
+        }
+
+        void waitResponseSlot(uint8_t slot) override
+        {
+            waits++;
+
+            if (releaseOnWait)
+            {
+                engine->releaseResponseSlot(slot);
+            }
+        }
+
+        SysExConf*           engine        = nullptr;
+        std::vector<uint8_t> slots         = {};
+        size_t               waits         = 0;
+        bool                 releaseOnWait = true;
+    };
+
+    RingDataHandler ringHandler;
+    SysExConf       sysExRing(ringHandler, M_ID);
+    uint8_t         ring[2 * MAX_MESSAGE_SIZE] = {};
+
+    ringHandler.engine = &sysExRing;
+
+    ASSERT_TRUE(sysExRing.setLayout(sysExLayout));
+    ASSERT_FALSE(sysExRing.setResponseRing(ring, MAX_RESPONSE_SLOTS + 1));
+    ASSERT_FALSE(sysExRing.setResponseRing(nullptr, 2));
+    ASSERT_TRUE(sysExRing.setResponseRing(ring, 2));
+
+    // special requests are still sent using sendResponse
+    sysExRing.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    ASSERT_TRUE(sysExRing.isConfigurationEnabled());
+    ASSERT_EQ(1, ringHandler.responseCounter());
+    ASSERT_EQ(0, ringHandler.slots.size());
+
+    // reference responses without the ring
+    openConn();
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+    ASSERT_EQ(3, dataHandler.responseCounter());
+
+    ringHandler.reset();
+
+    // two parts and final ack - third response needs to wait for the first slot
+    sysExRing.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+
+    ASSERT_EQ(3, ringHandler.responseCounter());
+    ASSERT_EQ((std::vector<uint8_t>{ 0, 1, 0 }), ringHandler.slots);
+    ASSERT_EQ(1, ringHandler.waits);
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(dataHandler.response(i), ringHandler.response(i));
+    }
+
+    // slots aren't released - response should be built internally once the ring is full
+    ASSERT_TRUE(sysExRing.setResponseRing(ring, 2));
+    ringHandler.reset();
+    ringHandler.slots.clear();
+    ringHandler.waits         = 0;
+    ringHandler.releaseOnWait = false;
+
+    sysExRing.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+
+    ASSERT_EQ(3, ringHandler.responseCounter());
+    ASSERT_EQ((std::vector<uint8_t>{ 0, 1 }), ringHandler.slots);
+    ASSERT_EQ(1, ringHandler.waits);
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(dataHandler.response(i), ringHandler.response(i));
+    }
+}
+
+TEST_F(SysExTest, ResponseSegments)
+{
+    class SegmentDataHandler : public SysExConfDataHandler
+    {
+        public:
+        bool sendResponseV(const ResponseSegment* segments, uint8_t count) override
+        {
+            std::vector<uint8_t> response;
+
+            for (uint8_t i = 0; i < count; i++)
+            {
+                response.insert(response.end(), segments[i].data, segments[i].data + segments[i].size);
+            }
+
+            headers.push_back(segments[static_cast<uint8_t>(responseSegment_t::HEADER)].data);
+            payloadSizes.push_back(segments[static_cast<uint8_t>(responseSegment_t::PAYLOAD)].size);
+            sendResponse(&response[0], response.size());
+
+            return true;
+        }
+
+        std::vector<const uint8_t*> headers      = {};
+        std::vector<uint16_t>       payloadSizes = {};
+    };
+
+    SegmentDataHandler segmentHandler;
+    SysExConf          sysExSegment(segmentHandler, M_ID);
+
+    ASSERT_TRUE(sysExSegment.setLayout(sysExLayout));
+    sysExSegment.setSegmentedResponses(true);
+
+    // special requests are sent using sendResponse
+    sysExSegment.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    ASSERT_TRUE(sysExSegment.isConfigurationEnabled());
+    ASSERT_EQ(0, segmentHandler.headers.size());
+
+    // reference responses
+    openConn();
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+    ASSERT_EQ(3, dataHandler.responseCounter());
+
+    segmentHandler.reset();
+    sysExSegment.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+    ASSERT_EQ(3, segmentHandler.responseCounter());
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(dataHandler.response(i), segmentHandler.response(i));
+    }
+
+    // header is kept in the same buffer for all parts, final ack isn't sent in segments
+    ASSERT_EQ(2, segmentHandler.headers.size());
+    ASSERT_EQ(segmentHandler.headers.at(0), segmentHandler.headers.at(1));
+
+    // payload contains values and end byte only
+    ASSERT_EQ((PARAMS_PER_MESSAGE * BYTES_PER_VALUE) + 1, segmentHandler.payloadSizes.at(0));
+    ASSERT_EQ(dataHandler.response(1).size() - GET_ALL_VALID_ALL_PARTS_7_E.size() + 1, segmentHandler.payloadSizes.at(1));
+
+    // frames are assembled for transports which don't accept segments
+    SysExConfDataHandler fallbackHandler;
+    SysExConf            sysExFallback(fallbackHandler, M_ID);
+    uint8_t              ring[2 * MAX_MESSAGE_SIZE] = {};
+
+    ASSERT_TRUE(sysExFallback.setLayout(sysExLayout));
+    ASSERT_TRUE(sysExFallback.setResponseRing(ring, 2));
+    sysExFallback.setSegmentedResponses(true);
+    sysExFallback.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+
+    fallbackHandler.reset();
+    sysExFallback.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+    ASSERT_EQ(3, fallbackHandler.responseCounter());
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(dataHandler.response(i), fallbackHandler.response(i));
+    }
+
+    // backup responses are sent in segments as well
+    dataHandler.reset();
+    handleMessage(BACKUP_ALL);
+
+    segmentHandler.reset();
+    segmentHandler.headers.clear();
+    sysExSegment.handleMessage(&BACKUP_ALL[0], BACKUP_ALL.size());
+    ASSERT_EQ(dataHandler.responseCounter(), segmentHandler.responseCounter());
+    ASSERT_EQ(dataHandler.responseCounter(), segmentHandler.headers.size());
+
+    for (size_t i = 0; i < dataHandler.responseCounter(); i++)
+    {
+        ASSERT_EQ(dataHandler.response(i), segmentHandler.response(i));
+    }
+
+    // error is reported with the same header
+    dataHandler.reset();
+    dataHandler.getResults.push_back(static_cast<uint8_t>(status_t::ERROR_READ));
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+
+    segmentHandler.reset();
+    segmentHandler.getResults.push_back(static_cast<uint8_t>(status_t::ERROR_READ));
+    sysExSegment.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+    ASSERT_EQ(1, segmentHandler.responseCounter());
+    ASSERT_EQ(dataHandler.response(0), segmentHandler.response(0));
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ERROR_READ), segmentHandler.response(0).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+}
+
+TEST_F(SysExTest, ParamsPerMessage)
+{
+    if (MAX_PARAMS_PER_MESSAGE < 64)
+    {
+        GTEST_SKIP() << "Library built without support for larger messages";
+    }
+
+    std::vector<uint8_t> data;
+
+    // session can't be configured without open connection
+    handleMessage(SET_SPECIAL_REQ_PARAM_PER_MSG);
+    verifyMessage(SET_SPECIAL_REQ_PARAM_PER_MSG, status_t::ERROR_CONNECTION);
+
+    openConn();
+
+    handleMessage(GET_SPECIAL_REQ_MAX_PARAM_PER_MSG);
+
+    data = {
+        SYSEX_PARAM(MAX_PARAMS_PER_MESSAGE)
+    };
+
+    verifyMessage(GET_SPECIAL_REQ_MAX_PARAM_PER_MSG, status_t::ACK, &data);
+    dataHandler.reset();
+
+    // values outside of allowed range
+    auto request = SET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1] = 0;
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = PARAMS_PER_MESSAGE - 1;
+    handleMessage(request);
+    verifyMessage(request, status_t::ERROR_NEW_VALUE);
+    dataHandler.reset();
+
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1] = Split14Bit(MAX_PARAMS_PER_MESSAGE + 1).high();
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = Split14Bit(MAX_PARAMS_PER_MESSAGE + 1).low();
+    handleMessage(request);
+    verifyMessage(request, status_t::ERROR_NEW_VALUE);
+    ASSERT_EQ(PARAMS_PER_MESSAGE, sysEx.paramsPerMessage());
+    dataHandler.reset();
+
+    // only params per message request can contain value
+    request                                               = SET_SPECIAL_REQ_PARAM_PER_MSG;
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = static_cast<uint8_t>(specialRequest_t::BYTES_PER_VALUE);
+    handleMessage(request);
+    verifyMessage(request, status_t::ERROR_MESSAGE_LENGTH);
+    dataHandler.reset();
+
+    handleMessage(SET_SPECIAL_REQ_PARAM_PER_MSG);
+    verifyMessage(SET_SPECIAL_REQ_PARAM_PER_MSG, status_t::ACK);
+    ASSERT_EQ(64, sysEx.paramsPerMessage());
+    dataHandler.reset();
+
+    handleMessage(GET_SPECIAL_REQ_PARAM_PER_MSG);
+
+    data = {
+        SYSEX_PARAM(64)
+    };
+
+    verifyMessage(GET_SPECIAL_REQ_PARAM_PER_MSG, status_t::ACK, &data);
+    dataHandler.reset();
+
+    // all parameters in section with multiple parts now fit in single part
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    ASSERT_EQ(GET_ALL_VALID_ALL_PARTS_7_E.size() + (SECTION_2_PARAMETERS * BYTES_PER_VALUE), dataHandler.response(0).size());
+    ASSERT_EQ(0x7E, dataHandler.response(1)[static_cast<uint8_t>(byteOrder_t::PART_BYTE)]);
+    dataHandler.reset();
+
+    // set request with default number of parameters is now too short
+    handleMessage(SET_ALL_MORE_PARTS1);
+    verifyMessage(SET_ALL_MORE_PARTS1, status_t::ERROR_MESSAGE_LENGTH);
+    dataHandler.reset();
+
+    // set whole section at once
+    request.assign(SET_ALL_MORE_PARTS1.begin(), SET_ALL_MORE_PARTS1.begin() + static_cast<uint8_t>(byteOrder_t::INDEX_BYTE));
+
+    for (uint16_t i = 0; i < SECTION_2_PARAMETERS; i++)
+    {
+        request.push_back(0);
+        request.push_back(i + 1);
+    }
+
+    request.push_back(0xF7);
+
+    handleMessage(request);
+    verifyMessage(request, status_t::ACK);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    ASSERT_EQ(SECTION_2_PARAMETERS, dataHandler.setRangeValues.size());
+    ASSERT_EQ(SECTION_2_PARAMETERS, dataHandler.setRangeValues.back());
+    dataHandler.reset();
+
+    // new session starts with default value
+    handleMessage(CONN_CLOSE);
+    openConn();
+    ASSERT_EQ(PARAMS_PER_MESSAGE, sysEx.paramsPerMessage());
+
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+    ASSERT_EQ(3, dataHandler.responseCounter());
+}
+
+TEST_F(SysExTest, LargeParts)
+{
+    // part no longer fits in 255 bytes
+    constexpr uint16_t PARAMETERS = 200;
+
+    if (MAX_PARAMS_PER_MESSAGE < PARAMETERS)
+    {
+        GTEST_SKIP() << "Library built without support for larger messages";
+    }
+
+    std::vector<Section> largeSections = {
+        {
+            PARAMETERS,
+            0,
+            0,
+        },
+    };
+
+    std::vector<Block> largeLayout = {
+        {
+            largeSections,
+        }
+    };
+
+    SysExConf sysExLarge(dataHandler, M_ID);
+    ASSERT_TRUE(sysExLarge.setLayout(largeLayout));
+
+    auto request = SET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1] = Split14Bit(PARAMETERS).high();
+    request[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = Split14Bit(PARAMETERS).low();
+
+    sysExLarge.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    sysExLarge.handleMessage(&request[0], request.size());
+    verifyMessage(request, status_t::ACK);
+    dataHandler.reset();
+
+    // whole section is set with single part and echoed back unchanged
+    request = {
+        0xF0,
+        SYS_EX_CONF_M_ID_0,
+        SYS_EX_CONF_M_ID_1,
+        SYS_EX_CONF_M_ID_2,
+        static_cast<uint8_t>(status_t::REQUEST),
+        0,
+        static_cast<uint8_t>(wish_t::SET),
+        static_cast<uint8_t>(amount_t::ALL),
+        0,
+        0,
+    };
+
+    for (uint16_t i = 0; i < PARAMETERS; i++)
+    {
+        auto split = Split14Bit(i);
+
+        request.push_back(split.high());
+        request.push_back(split.low());
+    }
+
+    request.push_back(0xF7);
+
+    sysExLarge.handleMessage(&request[0], request.size());
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyMessage(request, status_t::ACK);
+    ASSERT_EQ(PARAMETERS, dataHandler.setRangeValues.size());
+    ASSERT_EQ(PARAMETERS - 1, dataHandler.setRangeValues.back());
+    dataHandler.reset();
+
+    // all values are retrieved with single part as well
+    request = GET_ALL_VALID_ALL_PARTS_7_E;
+
+    request[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = 0;
+    sysExLarge.handleMessage(&request[0], request.size());
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    ASSERT_EQ(request.size() + (PARAMETERS * BYTES_PER_VALUE), dataHandler.response(0).size());
+    ASSERT_EQ(0xF7, dataHandler.response(0).back());
+}
+
+TEST_F(SysExTest, Codec)
+{
+    // all 14-bit values, count chosen so that scalar tail is used as well
+    constexpr size_t COUNT = 0x3FFF + 1 + 5;
+
+    std::vector<uint16_t> values(COUNT);
+    std::vector<uint8_t>  encoded(COUNT * BYTES_PER_VALUE);
+    std::vector<uint8_t>  encodedScalar(COUNT * BYTES_PER_VALUE);
+    std::vector<uint16_t> decoded(COUNT);
+    std::vector<uint16_t> decodedScalar(COUNT);
+
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        values[i] = i & 0x3FFF;
+    }
+
+    encode14Bit(&values[0], &encoded[0], COUNT);
+    encode14BitScalar(&values[0], &encodedScalar[0], COUNT);
+    ASSERT_EQ(encodedScalar, encoded);
+
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        auto split = Split14Bit(values[i]);
+
+        ASSERT_EQ(split.high(), encoded[(i * 2)]);
+        ASSERT_EQ(split.low(), encoded[(i * 2) + 1]);
+    }
+
+    decode14Bit(&encoded[0], &decoded[0], COUNT);
+    decode14BitScalar(&encoded[0], &decodedScalar[0], COUNT);
+    ASSERT_EQ(values, decoded);
+    ASSERT_EQ(values, decodedScalar);
+
+    // every possible byte pair, including the ones with bit 7 set, should be merged the same way
+    encoded.clear();
+
+    for (size_t high = 0; high < 0x100; high++)
+    {
+        for (size_t low = 0; low < 0x100; low++)
+        {
+            encoded.push_back(high);
+            encoded.push_back(low);
+        }
+    }
+
+    decoded.resize(encoded.size() / 2);
+    decode14Bit(&encoded[0], &decoded[0], decoded.size());
+
+    for (size_t i = 0; i < decoded.size(); i++)
+    {
+        ASSERT_EQ(Merge14Bit(encoded[(i * 2)], encoded[(i * 2) + 1]).value(), decoded[i]);
+    }
+
+    // odd sizes and unaligned buffers
+    for (size_t count = 0; count < 40; count++)
+    {
+        std::vector<uint8_t>  output((count * BYTES_PER_VALUE) + 1, 0xFF);
+        std::vector<uint16_t> input(count + 1, 0xFFFF);
+
+        encode14Bit(&values[1], &output[1], count);
+        ASSERT_EQ(0xFF, output[0]);
+
+        decode14Bit(&output[1], &input[1], count);
+        ASSERT_EQ(0xFFFF, input[0]);
+        ASSERT_TRUE(std::equal(&values[1], &values[1] + count, &input[1]));
+    }
+}
+
+TEST_F(SysExTest, Cache)
+{
+    constexpr uint8_t VALUE_BYTE = static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + (2 * BYTES_PER_VALUE) + 1;
+
+    // cache can't be used without layout
+    SysExConf sysExNoLayout(dataHandler, M_ID);
+    ASSERT_FALSE(sysExNoLayout.setCache(true));
+
+    ASSERT_EQ(SECTION_0_PARAMETERS + SECTION_1_PARAMETERS + SECTION_2_PARAMETERS, sysEx.parameters());
+    ASSERT_TRUE(sysEx.setCache(true));
+
+    openConn();
+
+    // first request is served by the handler, second one from cache
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(GET_SINGLE_VALID);
+
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    ASSERT_EQ(1, dataHandler.getCalls);
+    ASSERT_EQ(dataHandler.response(0), dataHandler.response(1));
+    dataHandler.reset();
+
+    // set updates the cache
+    handleMessage(SET_SINGLE_VALID);
+    handleMessage(GET_SINGLE_VALID);
+
+    ASSERT_EQ(0, dataHandler.getCalls);
+    ASSERT_EQ(TEST_NEW_VALUE_VALID, dataHandler.response(1).at(VALUE_BYTE));
+    dataHandler.reset();
+
+    // failed set invalidates the value
+    dataHandler.setResults.push_back(static_cast<uint8_t>(status_t::ERROR_WRITE));
+    handleMessage(SET_SINGLE_VALID);
+    handleMessage(GET_SINGLE_VALID);
+
+    ASSERT_EQ(1, dataHandler.getCalls);
+    ASSERT_EQ(TEST_VALUE_GET, dataHandler.response(1).at(VALUE_BYTE));
+    dataHandler.reset();
+
+    // value changed outside of the protocol
+    sysEx.invalidateCache(TEST_BLOCK_ID, TEST_SECTION_SINGLE_PART_ID, TEST_INDEX_ID);
+    handleMessage(GET_SINGLE_VALID);
+    ASSERT_EQ(1, dataHandler.getCalls);
+    dataHandler.reset();
+
+    // all parts are served from cache once retrieved
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+    ASSERT_EQ(2, dataHandler.getRangeCalls);
+
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+    handleMessage(BACKUP_ALL);
+    ASSERT_EQ(3, dataHandler.getRangeCalls);
+    ASSERT_EQ(dataHandler.response(0), dataHandler.response(2));
+    dataHandler.reset();
+
+    sysEx.invalidateCache(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID);
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+    ASSERT_EQ(2, dataHandler.getRangeCalls);
+    dataHandler.reset();
+
+    // warm-up retrieves each section with single call
+    sysEx.invalidateCache();
+    ASSERT_TRUE(sysEx.fillCache());
+    ASSERT_EQ(3, dataHandler.getRangeCalls);
+    dataHandler.reset();
+
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+    handleMessage(BACKUP_ALL);
+    ASSERT_EQ(0, dataHandler.getCalls);
+    ASSERT_EQ(0, dataHandler.getRangeCalls);
+    dataHandler.reset();
+
+    // read error during warm-up - only the first section isn't cached
+    dataHandler.getResults.push_back(static_cast<uint8_t>(status_t::ERROR_READ));
+    sysEx.invalidateCache();
+    ASSERT_FALSE(sysEx.fillCache());
+    dataHandler.reset();
+
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+    ASSERT_EQ(1, dataHandler.getCalls);
+    ASSERT_EQ(0, dataHandler.getRangeCalls);
+    dataHandler.reset();
+
+    // disabled cache
+    ASSERT_TRUE(sysEx.setCache(false));
+    ASSERT_FALSE(sysEx.fillCache());
+
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(GET_SINGLE_VALID);
+    ASSERT_EQ(2, dataHandler.getCalls);
+}
+
+TEST_F(SysExTest, ChangedParameters)
+{
+    constexpr uint8_t PAIRS_PER_PART = PARAMS_PER_MESSAGE / 2;
+
+    auto getChanged = GET_ALL_VALID_ALL_PARTS_7_E;
+    auto checkpoint = GET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    getChanged[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)] = static_cast<uint8_t>(amount_t::CHANGED);
+    checkpoint[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]   = static_cast<uint8_t>(specialRequest_t::CHECKPOINT);
+
+    auto verifyPairs = [&](size_t response, const std::vector<uint16_t>& indexes)
+    {
+        auto data = dataHandler.response(response);
+
+        ASSERT_EQ(getChanged.size() + (indexes.size() * 2 * BYTES_PER_VALUE), data.size());
+        ASSERT_EQ(static_cast<uint8_t>(status_t::ACK), data.at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+
+        for (size_t i = 0; i < indexes.size(); i++)
+        {
+            size_t pair = getChanged.size() - 1 + (i * 2 * BYTES_PER_VALUE);
+
+            ASSERT_EQ(indexes[i], Merge14Bit(data.at(pair), data.at(pair + 1)).value());
+            ASSERT_EQ(TEST_VALUE_GET, Merge14Bit(data.at(pair + 2), data.at(pair + 3)).value());
+        }
+    };
+
+    openConn();
+
+    // not available without tracking
+    handleMessage(getChanged);
+    verifyMessage(getChanged, status_t::ERROR_AMOUNT);
+    dataHandler.reset();
+
+    handleMessage(checkpoint);
+    verifyMessage(checkpoint, status_t::ERROR_NOT_SUPPORTED);
+    dataHandler.reset();
+
+    ASSERT_TRUE(sysEx.setDirtyTracking(true));
+
+    // nothing has been changed yet: single empty part and final ack
+    handleMessage(getChanged);
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    verifyPairs(0, {});
+    ASSERT_EQ(0x7E, dataHandler.response(1).at(static_cast<uint8_t>(byteOrder_t::PART_BYTE)));
+    dataHandler.reset();
+
+    // only get is supported
+    auto setChanged = SET_ALL_MORE_PARTS1;
+
+    setChanged[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)] = static_cast<uint8_t>(amount_t::CHANGED);
+    handleMessage(setChanged);
+    verifyMessage(setChanged, status_t::ERROR_AMOUNT);
+    dataHandler.reset();
+
+    // first part changed with the protocol, last parameter outside of it
+    handleMessage(SET_ALL_MORE_PARTS1);
+    sysEx.notifyChanged(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, SECTION_2_PARAMETERS - 1);
+    sysEx.notifyChanged(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, SECTION_2_PARAMETERS);
+    dataHandler.reset();
+
+    std::vector<uint16_t> expected;
+
+    for (uint16_t i = 0; i < PARAMS_PER_MESSAGE; i++)
+    {
+        expected.push_back(i);
+    }
+
+    expected.push_back(SECTION_2_PARAMETERS - 1);
+
+    handleMessage(getChanged);
+
+    ASSERT_EQ(4, dataHandler.responseCounter());
+    verifyPairs(0, std::vector<uint16_t>(expected.begin(), expected.begin() + PAIRS_PER_PART));
+    verifyPairs(1, std::vector<uint16_t>(expected.begin() + PAIRS_PER_PART, expected.begin() + (2 * PAIRS_PER_PART)));
+    verifyPairs(2, std::vector<uint16_t>(expected.begin() + (2 * PAIRS_PER_PART), expected.end()));
+    ASSERT_EQ(2, dataHandler.response(2).at(static_cast<uint8_t>(byteOrder_t::PART_BYTE)));
+    dataHandler.reset();
+
+    // specific part, nothing acknowledged yet
+    getChanged[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = 1;
+    handleMessage(getChanged);
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyPairs(0, std::vector<uint16_t>(expected.begin() + PAIRS_PER_PART, expected.begin() + (2 * PAIRS_PER_PART)));
+    dataHandler.reset();
+
+    // parameter changed after it has been reported is kept after checkpoint
+    handleMessage(SET_ALL_MORE_PARTS2);
+    handleMessage(checkpoint);
+    verifyMessage(checkpoint, status_t::ACK);
+    dataHandler.reset();
+
+    getChanged[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = 0x7F;
+    handleMessage(getChanged);
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    verifyPairs(0, { SECTION_2_PARAMETERS - 1 });
+    dataHandler.reset();
+
+    handleMessage(checkpoint);
+    handleMessage(getChanged);
+    verifyPairs(1, {});
+}
+
+TEST_F(SysExTest, ChangedParametersMaxParts)
+{
+    // more changed parameters than all parts can carry
+    constexpr uint16_t PAIRS_PER_PART = PARAMS_PER_MESSAGE / 2;
+    constexpr uint16_t REMAINING      = 84;
+    constexpr uint16_t PARAMETERS     = (MAX_PARTS * PAIRS_PER_PART) + REMAINING;
+
+    std::vector<Section> largeSections = {
+        {
+            PARAMETERS,
+            0,
+            0,
+        },
+    };
+
+    std::vector<Block> largeLayout = {
+        {
+            largeSections,
+        }
+    };
+
+    SysExConf sysExLarge(dataHandler, M_ID);
+    ASSERT_TRUE(sysExLarge.setLayout(largeLayout));
+    ASSERT_TRUE(sysExLarge.setDirtyTracking(true));
+
+    for (uint16_t i = 0; i < PARAMETERS; i++)
+    {
+        sysExLarge.notifyChanged(0, 0, i);
+    }
+
+    auto getChanged = GET_ALL_VALID_ALL_PARTS_7_E;
+    auto checkpoint = GET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    getChanged[static_cast<uint8_t>(byteOrder_t::AMOUNT_BYTE)]  = static_cast<uint8_t>(amount_t::CHANGED);
+    getChanged[static_cast<uint8_t>(byteOrder_t::BLOCK_BYTE)]   = 0;
+    getChanged[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = 0;
+    checkpoint[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]    = static_cast<uint8_t>(specialRequest_t::CHECKPOINT);
+
+    sysExLarge.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    dataHandler.reset();
+
+    // parts are never numbered as all parts request, final ack follows the last one
+    sysExLarge.handleMessage(&getChanged[0], getChanged.size());
+    ASSERT_EQ(MAX_PARTS + 1, dataHandler.responseCounter());
+
+    for (size_t i = 0; i < MAX_PARTS; i++)
+    {
+        auto data = dataHandler.response(i);
+
+        ASSERT_EQ(i, data.at(static_cast<uint8_t>(byteOrder_t::PART_BYTE)));
+        ASSERT_EQ(getChanged.size() + (PAIRS_PER_PART * 2 * BYTES_PER_VALUE), data.size());
+    }
+
+    ASSERT_EQ(0x7E, dataHandler.response(MAX_PARTS).at(static_cast<uint8_t>(byteOrder_t::PART_BYTE)));
+    dataHandler.reset();
+
+    // parameters which didn't fit are sent once the reported ones are acknowledged
+    sysExLarge.handleMessage(&checkpoint[0], checkpoint.size());
+    verifyMessage(checkpoint, status_t::ACK);
+    dataHandler.reset();
+
+    sysExLarge.handleMessage(&getChanged[0], getChanged.size());
+    ASSERT_EQ((REMAINING / PAIRS_PER_PART) + 2, dataHandler.responseCounter());
+
+    auto data = dataHandler.response(0);
+    auto pair = getChanged.size() - 1;
+
+    ASSERT_EQ(MAX_PARTS * PAIRS_PER_PART, Merge14Bit(data.at(pair), data.at(pair + 1)).value());
+}
+
+TEST_F(SysExTest, WriteBehind)
+{
+    constexpr uint8_t  VALUE_BYTE  = static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + (2 * BYTES_PER_VALUE) + 1;
+    constexpr uint32_t IDLE_TIME   = 100;
+    constexpr uint16_t JOURNAL_LEN = 3;
+
+    auto setOther = SET_SINGLE_VALID;
+
+    // neighbouring parameter so that both values are flushed with single call
+    setOther[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 1]++;
+
+    // write-behind can't be used without layout
+    SysExConf sysExNoLayout(dataHandler, M_ID);
+    ASSERT_FALSE(sysExNoLayout.setWriteBehind(true));
+
+    ASSERT_TRUE(sysEx.setWriteBehind(true, IDLE_TIME));
+
+    openConn();
+
+    // repeated writes are acknowledged without storing them
+    handleMessage(SET_SINGLE_VALID);
+    verifyMessage(SET_SINGLE_VALID, status_t::ACK);
+    handleMessage(SET_SINGLE_VALID);
+    handleMessage(setOther);
+    handleMessage(GET_SINGLE_VALID);
+
+    ASSERT_EQ(4, dataHandler.responseCounter());
+    ASSERT_EQ(0, dataHandler.setCalls);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+    ASSERT_EQ(0, dataHandler.getCalls);
+    ASSERT_EQ(TEST_NEW_VALUE_VALID, dataHandler.response(3).at(VALUE_BYTE));
+    dataHandler.reset();
+
+    // deferred values are returned with all parameters as well
+    auto getAll = GET_ALL_VALID_ALL_PARTS_7_F;
+
+    getAll[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = TEST_SECTION_SINGLE_PART_ID;
+    handleMessage(getAll);
+
+    auto   data  = dataHandler.response(0);
+    size_t value = data.size() - 2 - (2 * (SECTION_0_PARAMETERS - 1 - TEST_INDEX_ID));
+
+    ASSERT_EQ(TEST_NEW_VALUE_VALID, data.at(value));
+    ASSERT_EQ(TEST_VALUE_GET, data.at(value - 2));
+    ASSERT_EQ(1, dataHandler.getRangeCalls);
+    dataHandler.reset();
+
+    // idle time starts with first update after the write
+    sysEx.update(1000);
+    sysEx.update(1000 + IDLE_TIME - 1);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    sysEx.update(1000 + IDLE_TIME);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    ASSERT_EQ(std::vector<uint16_t>({ TEST_NEW_VALUE_VALID, TEST_NEW_VALUE_VALID }), dataHandler.setRangeValues);
+    dataHandler.reset();
+
+    // nothing left to store
+    sysEx.update(2000 + IDLE_TIME);
+    ASSERT_TRUE(sysEx.flush());
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    // failed flush keeps the values
+    handleMessage(SET_SINGLE_VALID);
+    dataHandler.setResults.push_back(static_cast<uint8_t>(status_t::ERROR_WRITE));
+    ASSERT_FALSE(sysEx.flush());
+    ASSERT_TRUE(sysEx.flush());
+    ASSERT_EQ(2, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // closing the connection stores deferred values
+    handleMessage(SET_SINGLE_VALID);
+    handleMessage(CONN_CLOSE);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // bounded journal
+    dataHandler.journal = true;
+    ASSERT_TRUE(sysEx.setWriteBehind(true, 0, JOURNAL_LEN));
+    openConn();
+
+    handleMessage(SET_SINGLE_VALID);
+    handleMessage(SET_SINGLE_VALID);
+    handleMessage(setOther);
+    ASSERT_EQ(JOURNAL_LEN, dataHandler.journalEntries.size());
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    // full journal is flushed and cleared before new entry is added
+    handleMessage(SET_SINGLE_VALID);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    ASSERT_EQ(1, dataHandler.journalEntries.size());
+
+    // entries from journal can be replayed after power loss
+    auto journal = dataHandler.journalEntries;
+
+    journal.push_back({ TEST_BLOCK_ID, 0xFF, 0, 0 });
+    dataHandler.reset();
+    sysEx.reset();
+    ASSERT_TRUE(sysEx.setLayout(sysExLayout));
+    ASSERT_TRUE(sysEx.replayJournal(journal.data(), journal.size()));
+    ASSERT_EQ(1, dataHandler.setCalls);
+    ASSERT_EQ(0, dataHandler.journalEntries.size());
+    dataHandler.reset();
+
+    // write-behind disabled after reset
+    openConn();
+    handleMessage(SET_SINGLE_VALID);
+    ASSERT_EQ(1, dataHandler.setCalls);
+}
+
+TEST_F(SysExTest, StagedWrites)
+{
+    // staging can't be used without layout
+    SysExConf sysExNoLayout(dataHandler, M_ID);
+    ASSERT_FALSE(sysExNoLayout.setStagedWrites(true));
+
+    ASSERT_TRUE(sysEx.setStagedWrites(true));
+
+    openConn();
+
+    // first part is only validated and buffered
+    handleMessage(SET_ALL_MORE_PARTS1);
+    verifyMessage(SET_ALL_MORE_PARTS1, status_t::ACK);
+    ASSERT_EQ(0, dataHandler.setCalls);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    // whole section is stored with single call once the last part arrives
+    handleMessage(SET_ALL_MORE_PARTS2);
+    verifyMessage(SET_ALL_MORE_PARTS2, status_t::ACK);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    ASSERT_EQ(SECTION_2_PARAMETERS, dataHandler.setRangeValues.size());
+    dataHandler.reset();
+
+    // sections with single part are stored immediately
+    std::vector<uint8_t> setAllSinglePart(SET_ALL_MORE_PARTS1.begin(), SET_ALL_MORE_PARTS1.begin() + static_cast<uint8_t>(byteOrder_t::INDEX_BYTE));
+
+    setAllSinglePart[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = TEST_SECTION_NOMINMAX;
+
+    for (size_t i = 0; i < SECTION_1_PARAMETERS * BYTES_PER_VALUE; i++)
+    {
+        setAllSinglePart.push_back(0);
+    }
+
+    setAllSinglePart.push_back(0xF7);
+    handleMessage(setAllSinglePart);
+    verifyMessage(setAllSinglePart, status_t::ACK);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // staged values are discarded once the connection is closed
+    handleMessage(SET_ALL_MORE_PARTS1);
+    handleMessage(CONN_CLOSE);
+    openConn();
+
+    handleMessage(SET_ALL_MORE_PARTS2);
+    verifyMessage(SET_ALL_MORE_PARTS2, status_t::ACK);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    // parts can arrive in any order
+    handleMessage(SET_ALL_MORE_PARTS1);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // response to the last part contains the result of storing whole section
+    dataHandler.setResults.push_back(static_cast<uint8_t>(status_t::ERROR_WRITE));
+    handleMessage(SET_ALL_MORE_PARTS1);
+    handleMessage(SET_ALL_MORE_PARTS2);
+    verifyMessage(SET_ALL_MORE_PARTS2, status_t::ERROR_WRITE);
+    dataHandler.reset();
+
+    // each session stages its own values
+    Session other(1);
+
+    handleMessage(SET_ALL_MORE_PARTS1);
+    sysEx.handleMessage(other, &CONN_OPEN[0], CONN_OPEN.size());
+    sysEx.handleMessage(other, &SET_ALL_MORE_PARTS2[0], SET_ALL_MORE_PARTS2.size());
+    verifyMessage(SET_ALL_MORE_PARTS2, status_t::ACK);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    handleMessage(SET_ALL_MORE_PARTS2);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+
+    sysEx.handleMessage(other, &SET_ALL_MORE_PARTS1[0], SET_ALL_MORE_PARTS1.size());
+    ASSERT_EQ(2, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // closing other session keeps staged values
+    handleMessage(SET_ALL_MORE_PARTS1);
+    sysEx.handleMessage(other, &SET_ALL_MORE_PARTS1[0], SET_ALL_MORE_PARTS1.size());
+    sysEx.handleMessage(other, &CONN_CLOSE[0], CONN_CLOSE.size());
+    handleMessage(SET_ALL_MORE_PARTS2);
+    verifyMessage(SET_ALL_MORE_PARTS2, status_t::ACK);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // value stored meanwhile isn't overwritten by staged one
+    auto setSingle = SET_SINGLE_VALID;
+
+    setSingle[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = TEST_SECTION_MULTIPLE_PARTS_ID;
+
+    handleMessage(SET_ALL_MORE_PARTS1);
+    sysEx.handleMessage(other, &CONN_OPEN[0], CONN_OPEN.size());
+    sysEx.handleMessage(other, &setSingle[0], setSingle.size());
+    handleMessage(SET_ALL_MORE_PARTS2);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    ASSERT_EQ(TEST_NEW_VALUE_VALID, dataHandler.setRangeValues.at(TEST_INDEX_ID));
+    dataHandler.reset();
+
+    // staging is used in user error ignore mode as well
+    sysEx.setUserErrorIgnoreMode(true);
+    handleMessage(SET_ALL_MORE_PARTS1);
+    verifyMessage(SET_ALL_MORE_PARTS1, status_t::ACK);
+    ASSERT_EQ(0, dataHandler.setCalls);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+
+    handleMessage(SET_ALL_MORE_PARTS2);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+    sysEx.setUserErrorIgnoreMode(false);
+    dataHandler.reset();
+
+    // disabled staging
+    ASSERT_TRUE(sysEx.setStagedWrites(false));
+    handleMessage(SET_ALL_MORE_PARTS1);
+    ASSERT_EQ(1, dataHandler.setRangeCalls);
+}
+
+TEST_F(SysExTest, Compression)
+{
+    constexpr uint8_t PAYLOAD_BYTE = static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + (2 * BYTES_PER_VALUE);
+
+    auto getCompression = GET_SPECIAL_REQ_PARAM_PER_MSG;
+    auto setCompression = SET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    getCompression[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = static_cast<uint8_t>(specialRequest_t::COMPRESSION);
+    setCompression[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = static_cast<uint8_t>(specialRequest_t::COMPRESSION);
+
+    // run-length coding
+    std::vector<uint16_t> values = { 0, 0, 0, 0, 5, 0x3FFF, 5, 5, 7, 7, 7 };
+    std::vector<uint8_t>  coded(RLE_MAX_SIZE(values.size()));
+    std::vector<uint16_t> decoded(values.size());
+
+    coded.resize(encodeRle(&values[0], &coded[0], values.size()));
+
+    ASSERT_EQ(std::vector<uint8_t>({ RLE_RUN | 3, 0, 0, 3, 0, 5, 0x7F, 0x7F, 0, 5, 0, 5, RLE_RUN | 2, 0, 7 }), coded);
+    ASSERT_TRUE(decodeRle(&coded[0], coded.size(), &decoded[0], decoded.size()));
+    ASSERT_EQ(values, decoded);
+
+    // malformed input
+    ASSERT_FALSE(decodeRle(&coded[0], coded.size() - 1, &decoded[0], decoded.size()));
+    ASSERT_FALSE(decodeRle(&coded[0], coded.size(), &decoded[0], decoded.size() - 1));
+    ASSERT_FALSE(decodeRle(&coded[0], 4, &decoded[0], decoded.size()));
+
+    // long literal and run groups
+    values.assign(300, 0);
+
+    for (size_t i = 0; i < 150; i++)
+    {
+        values[i] = i;
+    }
+
+    coded.resize(RLE_MAX_SIZE(values.size()));
+    decoded.resize(values.size());
+    coded.resize(encodeRle(&values[0], &coded[0], values.size()));
+    ASSERT_EQ(RLE_MAX_SIZE(150) + 3 * 3, coded.size());
+    ASSERT_TRUE(decodeRle(&coded[0], coded.size(), &decoded[0], decoded.size()));
+    ASSERT_EQ(values, decoded);
+
+    openConn();
+
+    // values aren't compressed by default
+    handleMessage(getCompression);
+    ASSERT_EQ(SPECIAL_REQ_VALUE_MSG_SIZE, dataHandler.response(0).size());
+    ASSERT_EQ(static_cast<uint8_t>(compression_t::NONE), dataHandler.response(0).at(static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2));
+    dataHandler.reset();
+
+    setCompression[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = static_cast<uint8_t>(compression_t::AMOUNT);
+    handleMessage(setCompression);
+    verifyMessage(setCompression, status_t::ERROR_NEW_VALUE);
+    dataHandler.reset();
+
+    setCompression[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = static_cast<uint8_t>(compression_t::RLE);
+    handleMessage(setCompression);
+    verifyMessage(setCompression, status_t::ACK);
+    ASSERT_EQ(compression_t::RLE, sysEx.compression());
+    dataHandler.reset();
+
+    // all values in part are the same
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_F);
+    ASSERT_EQ(2, dataHandler.responseCounter());
+
+    auto response = dataHandler.response(0);
+
+    ASSERT_EQ(PAYLOAD_BYTE + 3 + 1, response.size());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ACK), response.at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+    ASSERT_EQ(RLE_RUN | (PARAMS_PER_MESSAGE - 1), response.at(PAYLOAD_BYTE));
+    ASSERT_EQ(0, response.at(PAYLOAD_BYTE + 1));
+    ASSERT_EQ(TEST_VALUE_GET, response.at(PAYLOAD_BYTE + 2));
+    dataHandler.reset();
+
+    // backup can be restored in the same session
+    handleMessage(BACKUP_ALL);
+    ASSERT_EQ(1, dataHandler.responseCounter());
+
+    auto backup = dataHandler.response(0);
+
+    ASSERT_EQ(static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 3 + 1, backup.size());
+    dataHandler.reset();
+
+    handleMessage(backup);
+    verifyMessage(backup, status_t::ACK);
+    ASSERT_EQ(std::vector<uint16_t>(SECTION_0_PARAMETERS, TEST_VALUE_GET), dataHandler.setRangeValues);
+    dataHandler.reset();
+
+    // coded values don't match number of parameters in part
+    backup[static_cast<uint8_t>(byteOrder_t::INDEX_BYTE)]--;
+    handleMessage(backup);
+    verifyMessage(backup, status_t::ERROR_MESSAGE_LENGTH);
+    ASSERT_EQ(0, dataHandler.setRangeCalls);
+    dataHandler.reset();
+
+    // uncompressed values are rejected
+    handleMessage(SET_ALL_MORE_PARTS1);
+    verifyMessage(SET_ALL_MORE_PARTS1, status_t::ERROR_MESSAGE_LENGTH);
+    dataHandler.reset();
+
+    // each session starts without compression
+    handleMessage(CONN_CLOSE);
+    openConn();
+    ASSERT_EQ(compression_t::NONE, sysEx.compression());
+}
+
+TEST_F(SysExTest, Dump)
+{
+    auto dump = GET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    dump[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = static_cast<uint8_t>(specialRequest_t::DUMP);
+
+    // connection needs to be opened first
+    handleMessage(dump);
+    verifyMessage(dump, status_t::ERROR_CONNECTION);
+    dataHandler.reset();
+
+    openConn();
+
+    // responses are the same as the ones for all parts of every section
+    std::vector<std::vector<uint8_t>> expected;
+
+    for (uint8_t section = 0; section < sysEx.sections(TEST_BLOCK_ID); section++)
+    {
+        auto request = GET_ALL_VALID_ALL_PARTS_7_F;
+
+        request[static_cast<uint8_t>(byteOrder_t::SECTION_BYTE)] = section;
+        handleMessage(request);
+    }
+
+    for (size_t i = 0; i < dataHandler.responseCounter(); i++)
+    {
+        expected.push_back(dataHandler.response(i));
+    }
+
+    ASSERT_EQ(4, expected.size());
+    dataHandler.reset();
+
+    handleMessage(dump);
+    ASSERT_EQ(expected.size(), dataHandler.responseCounter());
+
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        ASSERT_EQ(expected.at(i), dataHandler.response(i));
+    }
+
+    dataHandler.reset();
+
+    // part 126: final ack
+    dump[static_cast<uint8_t>(byteOrder_t::PART_BYTE)] = 0x7E;
+    handleMessage(dump);
+    ASSERT_EQ(expected.size() + 1, dataHandler.responseCounter());
+    verifyMessage(dump, status_t::ACK);
+    dataHandler.reset();
+
+    // backup responses
+    auto dumpBackup = SET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    dumpBackup[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]     = static_cast<uint8_t>(specialRequest_t::DUMP);
+    dumpBackup[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1] = 0;
+    dumpBackup[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = static_cast<uint8_t>(wish_t::BACKUP);
+
+    handleMessage(dumpBackup);
+    ASSERT_EQ(expected.size(), dataHandler.responseCounter());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::REQUEST), dataHandler.response(0).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+    ASSERT_EQ(static_cast<uint8_t>(wish_t::SET), dataHandler.response(0).at(static_cast<uint8_t>(byteOrder_t::WISH_BYTE)));
+    dataHandler.reset();
+
+    dumpBackup[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = static_cast<uint8_t>(wish_t::SET);
+    handleMessage(dumpBackup);
+    verifyMessage(dumpBackup, status_t::ERROR_NEW_VALUE);
+    dataHandler.reset();
+
+    // dump stops on first error
+    dataHandler.getResults.push_back(static_cast<uint8_t>(status_t::ERROR_READ));
+    handleMessage(dump);
+    ASSERT_EQ(1, dataHandler.responseCounter());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ERROR_READ), dataHandler.response(0).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+}
+
+TEST_F(SysExTest, FlowControl)
+{
+    auto setWindow = SET_SPECIAL_REQ_PARAM_PER_MSG;
+    auto getWindow = GET_SPECIAL_REQ_PARAM_PER_MSG;
+    auto windowAck = GET_SPECIAL_REQ_PARAM_PER_MSG;
+    auto dump      = GET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    setWindow[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]     = static_cast<uint8_t>(specialRequest_t::WINDOW);
+    setWindow[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = 1;
+    getWindow[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]     = static_cast<uint8_t>(specialRequest_t::WINDOW);
+    windowAck[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]     = static_cast<uint8_t>(specialRequest_t::WINDOW_ACK);
+    dump[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]          = static_cast<uint8_t>(specialRequest_t::DUMP);
+    dump[static_cast<uint8_t>(byteOrder_t::PART_BYTE)]          = 0x7E;
+
+    auto responses = [&]()
+    {
+        std::vector<std::vector<uint8_t>> all;
+
+        for (size_t i = 0; i < dataHandler.responseCounter(); i++)
+        {
+            all.push_back(dataHandler.response(i));
+        }
+
+        return all;
+    };
+
+    openConn();
+
+    // reference responses without flow control
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+    auto expected = responses();
+    ASSERT_EQ(3, expected.size());
+    dataHandler.reset();
+
+    handleMessage(dump);
+    auto expectedDump = responses();
+    ASSERT_EQ(5, expectedDump.size());
+    dataHandler.reset();
+
+    // acknowledgement without window
+    handleMessage(windowAck);
+    verifyMessage(windowAck, status_t::ERROR_NOT_SUPPORTED);
+    dataHandler.reset();
+
+    handleMessage(setWindow);
+    verifyMessage(setWindow, status_t::ACK);
+    dataHandler.reset();
+
+    handleMessage(getWindow);
+    ASSERT_EQ(1, dataHandler.response(0).at(static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2));
+    dataHandler.reset();
+
+    // one frame per acknowledgement, including the final ack
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+
+    for (size_t i = 1; i < expected.size(); i++)
+    {
+        ASSERT_EQ(i, dataHandler.responseCounter());
+        handleMessage(windowAck);
+    }
+
+    ASSERT_EQ(expected, responses());
+
+    // nothing left to send
+    handleMessage(windowAck);
+    ASSERT_EQ(expected.size(), dataHandler.responseCounter());
+    dataHandler.reset();
+
+    // any other request cancels paused transfer
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(windowAck);
+    ASSERT_EQ(2, dataHandler.responseCounter());
+    dataHandler.reset();
+
+    // dump with larger window, frames acknowledged one by one
+    setWindow[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = 2;
+    handleMessage(setWindow);
+    dataHandler.reset();
+
+    auto windowAckSingle = setWindow;
+
+    windowAckSingle[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]     = static_cast<uint8_t>(specialRequest_t::WINDOW_ACK);
+    windowAckSingle[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = 1;
+
+    handleMessage(dump);
+    ASSERT_EQ(2, dataHandler.responseCounter());
+
+    handleMessage(windowAckSingle);
+    ASSERT_EQ(3, dataHandler.responseCounter());
+
+    handleMessage(windowAck);
+    ASSERT_EQ(5, dataHandler.responseCounter());
+    ASSERT_EQ(expectedDump, responses());
+    dataHandler.reset();
+
+    // each session starts without flow control
+    handleMessage(CONN_CLOSE);
+    openConn();
+
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+    ASSERT_EQ(expected.size(), dataHandler.responseCounter());
+}
+
+#ifdef SYS_EX_CONF_STATS
+TEST_F(SysExTest, Stats)
+{
+    constexpr uint32_t TICKS_PER_REQUEST = 5;
+    constexpr uint8_t  LATENCY_BUCKET    = 3;    // [4, 8)
+    constexpr uint8_t  GET               = static_cast<uint8_t>(wish_t::GET);
+    constexpr uint8_t  SINGLE            = static_cast<uint8_t>(amount_t::SINGLE);
+    constexpr uint8_t  ACK               = static_cast<uint8_t>(status_t::ACK);
+    constexpr uint8_t  ERROR_READ        = static_cast<uint8_t>(status_t::ERROR_READ);
+
+    static uint32_t time = 0;
+
+    // every request takes the same amount of time: clock is called once at the start and once at the end
+    sysEx.setStatsClock([]()
+                        {
+                            time += TICKS_PER_REQUEST;
+                            return time;
+                        });
+
+    auto foreign = GET_SINGLE_VALID;
+    auto dropped = GET_SINGLE_VALID;
+
+    foreign[static_cast<uint8_t>(byteOrder_t::ID_BYTE_1)]++;
+    dropped.pop_back();
+
+    handleMessage(foreign);
+    handleMessage(dropped);
+    openConn();
+
+    handleMessage(GET_SINGLE_VALID);
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+
+    dataHandler.getResults.push_back(ERROR_READ);
+    handleMessage(GET_SINGLE_VALID);
+
+    auto stats = sysEx.stats();
+
+    ASSERT_EQ(1, stats.foreignFrames);
+    ASSERT_EQ(1, stats.droppedFrames);
+    ASSERT_EQ(4, stats.frames);
+    ASSERT_EQ(1, stats.specialRequests);
+    ASSERT_EQ(2, stats.requests[GET][SINGLE]);
+    ASSERT_EQ(1, stats.requests[GET][static_cast<uint8_t>(amount_t::ALL)]);
+    ASSERT_EQ(3, stats.statuses[ACK]);
+    ASSERT_EQ(1, stats.statuses[ERROR_READ]);
+    ASSERT_EQ(1 + 1 + 3 + 1, stats.responses);
+    ASSERT_EQ(2, stats.latency[GET][SINGLE][LATENCY_BUCKET]);
+    ASSERT_EQ(1, stats.specialLatency[LATENCY_BUCKET]);
+    ASSERT_EQ(1, stats.statusLatency[ERROR_READ][LATENCY_BUCKET]);
+    dataHandler.reset();
+
+    // counters can be retrieved by the host as well
+    auto getStats = GET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    getStats[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)] = static_cast<uint8_t>(specialRequest_t::STATS);
+    handleMessage(getStats);
+
+    auto   response = dataHandler.response(0);
+    size_t value    = getStats.size() - 1;
+
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ACK), response.at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+    ASSERT_EQ(STATS_COUNTERS, Merge14Bit(response.at(value), response.at(value + 1)).value());
+    ASSERT_EQ(5, Merge14Bit(response.at(value + 6), response.at(value + 7)).value());
+    dataHandler.reset();
+
+    // out of range counter
+    auto getStatsFrom = SET_SPECIAL_REQ_PARAM_PER_MSG;
+
+    getStatsFrom[static_cast<uint8_t>(byteOrder_t::WISH_BYTE)]     = static_cast<uint8_t>(specialRequest_t::STATS);
+    getStatsFrom[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 1] = Split14Bit(STATS_COUNTERS).high();
+    getStatsFrom[static_cast<uint8_t>(byteOrder_t::WISH_BYTE) + 2] = Split14Bit(STATS_COUNTERS).low();
+    handleMessage(getStatsFrom);
+    verifyMessage(getStatsFrom, status_t::ERROR_NEW_VALUE);
+
+    sysEx.resetStats();
+    ASSERT_EQ(0, sysEx.stats().frames);
+
+    // custom errors returned by the handler share single counter
+    dataHandler.getResults.push_back(0x21);
+    handleMessage(GET_SINGLE_VALID);
+
+    ASSERT_EQ(1, sysEx.stats().statuses[STATS_STATUS_OTHER]);
+    ASSERT_EQ(0, sysEx.stats().statuses[ACK]);
+}
+#endif
+
+TEST_F(SysExTest, MultiPort)
+{
+    Session usb(1);
+    Session din(2);
+
+    dataHandler.sysEx = &sysEx;
+
+    // connection is opened only on the port on which the request has been received
+    sysEx.handleMessage(usb, &CONN_OPEN[0], CONN_OPEN.size());
+    ASSERT_TRUE(usb.isConfigurationEnabled());
+    ASSERT_FALSE(din.isConfigurationEnabled());
+    ASSERT_FALSE(sysEx.isConfigurationEnabled());
+    ASSERT_EQ(std::vector<uint8_t>({ 1 }), dataHandler.responsePorts);
+    dataHandler.reset();
+
+    sysEx.handleMessage(din, &GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    verifyMessage(GET_SINGLE_VALID, status_t::ERROR_CONNECTION);
+    ASSERT_EQ(std::vector<uint8_t>({ 2 }), dataHandler.responsePorts);
+    dataHandler.reset();
+
+    // outside of request handling, default session is active
+    ASSERT_EQ(0, sysEx.port());
+
+    // interleaved streams are reassembled separately on each port
+    const std::vector<uint8_t> DATA = {
+        SYSEX_PARAM(TEST_VALUE_GET)
+    };
+
+    sysEx.handleMessage(din, &CONN_OPEN[0], CONN_OPEN.size());
+    dataHandler.reset();
+
+    sysEx.feed(din, &GET_SINGLE_VALID[0], 6);
+    sysEx.feed(usb, &GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+    sysEx.feed(din, &GET_SINGLE_VALID[6], GET_SINGLE_VALID.size() - 6);
+    verifyMessage(GET_SINGLE_VALID, status_t::ACK, &DATA);
+    ASSERT_EQ(std::vector<uint8_t>({ 1, 2 }), dataHandler.responsePorts);
+    dataHandler.reset();
+
+    // closing the connection on one port doesn't affect the others
+    sysEx.handleMessage(usb, &CONN_CLOSE[0], CONN_CLOSE.size());
+    ASSERT_FALSE(usb.isConfigurationEnabled());
+    ASSERT_TRUE(din.isConfigurationEnabled());
+
+    sysEx.reset(din);
+    ASSERT_FALSE(din.isConfigurationEnabled());
+}
+
+#ifdef SYS_EX_CONF_THREAD_SAFE
+TEST_F(SysExTest, Concurrency)
+{
+    constexpr size_t CLIENTS    = 4;
+    constexpr size_t ITERATIONS = 500;
+
+    class ConcurrentDataHandler : public DataHandler
+    {
+        public:
+        ConcurrentDataHandler() = default;
+
+        uint8_t get([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t index, uint16_t& value) override
+        {
+            value = TEST_VALUE_GET;
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t set([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t index, uint16_t newValue) override
+        {
+            // only the handler itself needs to guard its storage
+            std::lock_guard<std::mutex> lock(_mutex);
+            _storage = newValue;
+
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t customRequest([[maybe_unused]] uint16_t request, [[maybe_unused]] CustomResponse& customResponse) override
+        {
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        void sendResponse(uint8_t* array, [[maybe_unused]] uint16_t size) override
+        {
+            if (array[static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)] != static_cast<uint8_t>(status_t::ACK))
+            {
+                errors++;
+            }
+
+            responses.at(sysEx->port())++;
+        }
+
+        const SysExConf*                         sysEx     = nullptr;
+        std::array<std::atomic<size_t>, CLIENTS> responses = {};
+        std::atomic<size_t>                      errors    = 0;
+
+        private:
+        std::mutex _mutex;
+        uint16_t   _storage = 0;
+    };
+
+    ConcurrentDataHandler    concurrentHandler;
+    SysExConf                sysExConcurrent(concurrentHandler, M_ID);
+    std::vector<std::thread> clients;
+
+    auto client = [&](size_t port)
+    {
+        Session session(port);
+
+        // first client edits values while the others read them
+        const auto& request = port ? GET_SINGLE_VALID : SET_SINGLE_VALID;
+
+        sysExConcurrent.handleMessage(session, &CONN_OPEN[0], CONN_OPEN.size());
+
+        for (size_t i = 0; i < ITERATIONS; i++)
+        {
+            sysExConcurrent.handleMessage(session, &request[0], request.size());
+            sysExConcurrent.handleMessage(session, &GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+        }
+    };
+
+    concurrentHandler.sysEx = &sysExConcurrent;
+    ASSERT_TRUE(sysExConcurrent.setLayout(sysExLayout));
+    ASSERT_TRUE(sysExConcurrent.setCache(true));
+
+    for (size_t port = 0; port < CLIENTS; port++)
+    {
+        clients.emplace_back(client, port);
+    }
+
+    for (auto& thread : clients)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(0, concurrentHandler.errors);
+
+    // connection open, single value and two parts with final ack per iteration, all on the originating port
+    for (size_t port = 0; port < CLIENTS; port++)
+    {
+        ASSERT_EQ(1 + (ITERATIONS * 4), concurrentHandler.responses.at(port));
+    }
+}
+
+TEST_F(SysExTest, ConcurrentSlowWrite)
+{
+    class SlowDataHandler : public DataHandler
+    {
+        public:
+        SlowDataHandler() = default;
+
+        uint8_t get([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t index, uint16_t& value) override
+        {
+            value = TEST_VALUE_GET;
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t set([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t index, [[maybe_unused]] uint16_t newValue) override
+        {
+            writing = true;
+
+            // other session must be able to complete its request while the value is being stored
+            for (size_t i = 0; (i < 2000) && !readDone; i++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            overlapped = readDone.load();
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        uint8_t customRequest([[maybe_unused]] uint16_t request, [[maybe_unused]] CustomResponse& customResponse) override
+        {
+            return static_cast<uint8_t>(status_t::ACK);
+        }
+
+        void sendResponse([[maybe_unused]] uint8_t* array, [[maybe_unused]] uint16_t size) override
+        {
+        }
+
+        std::atomic<bool> writing    = false;
+        std::atomic<bool> readDone   = false;
+        std::atomic<bool> overlapped = false;
+    };
+
+    SlowDataHandler slowHandler;
+    SysExConf       sysExSlow(slowHandler, M_ID);
+    Session         writer(0);
+    Session         reader(1);
+
+    ASSERT_TRUE(sysExSlow.setLayout(sysExLayout));
+    ASSERT_TRUE(sysExSlow.setCache(true));
+    sysExSlow.handleMessage(writer, &CONN_OPEN[0], CONN_OPEN.size());
+    sysExSlow.handleMessage(reader, &CONN_OPEN[0], CONN_OPEN.size());
+
+    std::thread writeThread([&]()
+                            {
+                                sysExSlow.handleMessage(writer, &SET_SINGLE_VALID[0], SET_SINGLE_VALID.size());
+                            });
+
+    while (!slowHandler.writing)
+    {
+        std::this_thread::yield();
+    }
+
+    sysExSlow.handleMessage(reader, &GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    slowHandler.readDone = true;
+    writeThread.join();
+
+    // get request wasn't blocked by the value being stored
+    ASSERT_TRUE(slowHandler.overlapped);
+}
+#endif
+
+TEST_F(SysExTest, Client)
+{
+    class LoopbackTransport : public SysExConfClient::Transport
+    {
+        public:
+        bool send(const uint8_t* array, uint16_t size) override
+        {
+            requests.emplace_back(array, array + size);
+            return true;
+        }
+
+        std::vector<std::vector<uint8_t>> requests = {};
+    };
+
+    LoopbackTransport         transport;
+    SysExConfClient           client(transport, M_ID);
+    std::vector<ClientResult> results;
+
+    auto collect = [&results](const ClientResult& result)
+    {
+        results.push_back(result);
+    };
+
+    // passes requests sent so far to the device and its responses back to the client
+    auto exchange = [&]()
+    {
+        auto requests = std::move(transport.requests);
+
+        transport.requests.clear();
+        dataHandler.reset();
+
+        for (auto& request : requests)
+        {
+            handleMessage(request);
+        }
+
+        for (size_t i = 0; i < dataHandler.responseCounter(); i++)
+        {
+            auto response = dataHandler.response(i);
+            ASSERT_TRUE(client.handleMessage(&response[0], response.size()));
+        }
+    };
+
+    const std::vector<uint16_t> ALL_VALUES(SECTION_2_PARAMETERS, TEST_VALUE_GET);
+
+    client.setPipelineDepth(4);
+
+    // requests following connection open are sent once it's acknowledged
+    ASSERT_TRUE(client.special(specialRequest_t::CONN_OPEN, collect));
+    ASSERT_TRUE(client.get(TEST_BLOCK_ID, TEST_SECTION_SINGLE_PART_ID, TEST_INDEX_ID, collect));
+    ASSERT_TRUE(client.getAll(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, collect));
+    ASSERT_TRUE(client.backup(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, collect));
+    ASSERT_TRUE(client.custom(CUSTOM_REQUEST_ID_VALID, collect));
+    ASSERT_TRUE(client.get(TEST_BLOCK_ID, TEST_SECTION_SINGLE_PART_ID, TEST_INVALID_PARAMETER_B0S0, collect));
+    ASSERT_EQ(1, transport.requests.size());
+    ASSERT_EQ(5, client.queued());
+
+    exchange();
+    ASSERT_EQ(1, results.size());
+    ASSERT_TRUE(sysEx.isConfigurationEnabled());
+    ASSERT_EQ(4, transport.requests.size());
+    ASSERT_EQ(4, client.inFlight());
+    ASSERT_EQ(1, client.queued());
+
+    exchange();
+    exchange();
+    ASSERT_EQ(0, client.inFlight());
+    ASSERT_EQ(0, client.queued());
+    ASSERT_EQ(6, results.size());
+
+    ASSERT_EQ(status_t::ACK, results.at(0).status);
+    ASSERT_TRUE(results.at(0).values.empty());
+    ASSERT_EQ(status_t::ACK, results.at(1).status);
+    ASSERT_EQ(std::vector<uint16_t>({ TEST_VALUE_GET }), results.at(1).values);
+    ASSERT_EQ(status_t::ACK, results.at(2).status);
+    ASSERT_EQ(ALL_VALUES, results.at(2).values);
+    ASSERT_EQ(status_t::ACK, results.at(3).status);
+    ASSERT_EQ(ALL_VALUES, results.at(3).values);
+    ASSERT_EQ(status_t::ACK, results.at(4).status);
+    ASSERT_EQ(std::vector<uint16_t>({ CUSTOM_REQUEST_VALUE }), results.at(4).values);
+    ASSERT_EQ(status_t::ERROR_INDEX, results.at(5).status);
+    ASSERT_TRUE(results.at(5).values.empty());
+
+    // nothing is in flight
+    auto response = dataHandler.response(0);
+    ASSERT_FALSE(client.handleMessage(&response[0], response.size()));
+
+    // values are split into default number of parameters per message
+    results.clear();
+    ASSERT_TRUE(client.setAll(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, ALL_VALUES, collect));
+    ASSERT_EQ(2, transport.requests.size());
+
+    exchange();
+    ASSERT_EQ(1, results.size());
+    ASSERT_EQ(status_t::ACK, results.at(0).status);
+    ASSERT_EQ(SECTION_2_PARAMETERS, dataHandler.setCalls);
+
+    // negotiated settings are used for requests following the negotiation
+    constexpr uint16_t NEGOTIATED_PARAMS_PER_MESSAGE = std::min<uint16_t>(64, MAX_PARAMS_PER_MESSAGE);
+
+    results.clear();
+    ASSERT_TRUE(client.special(specialRequest_t::PARAMS_PER_MESSAGE, NEGOTIATED_PARAMS_PER_MESSAGE, collect));
+    ASSERT_TRUE(client.special(specialRequest_t::COMPRESSION, static_cast<uint16_t>(compression_t::RLE), collect));
+    ASSERT_TRUE(client.getAll(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, collect));
+    ASSERT_TRUE(client.setAll(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, ALL_VALUES, collect));
+
+    while (!transport.requests.empty())
+    {
+        exchange();
+    }
+
+    ASSERT_EQ(4, results.size());
+    ASSERT_EQ(NEGOTIATED_PARAMS_PER_MESSAGE, client.paramsPerMessage());
+    ASSERT_EQ(compression_t::RLE, client.compression());
+    ASSERT_EQ(ALL_VALUES, results.at(2).values);
+    ASSERT_EQ(status_t::ACK, results.at(3).status);
+    ASSERT_EQ(SECTION_2_PARAMETERS, dataHandler.setCalls);
+
+    // values are set with run-length coded parts, echoed in response
+    ASSERT_EQ(static_cast<uint8_t>(byteOrder_t::INDEX_BYTE) + 3 + 1, dataHandler.response(dataHandler.responseCounter() - 1).size());
+
+    // settings are restored once the connection is closed
+    ASSERT_TRUE(client.special(specialRequest_t::CONN_CLOSE, collect));
+    exchange();
+    ASSERT_FALSE(sysEx.isConfigurationEnabled());
+    ASSERT_EQ(PARAMS_PER_MESSAGE, client.paramsPerMessage());
+    ASSERT_EQ(compression_t::NONE, client.compression());
+
+    // values which don't fit in all parts are rejected without sending anything
+    results.clear();
+    ASSERT_TRUE(client.setAll(TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, std::vector<uint16_t>(MAX_PARAMETERS + 1, 0), collect));
+    ASSERT_TRUE(transport.requests.empty());
+    ASSERT_EQ(1, results.size());
+    ASSERT_EQ(status_t::ERROR_PART, results.at(0).status);
+
+    // requests which can't be tracked by the client are rejected
+    ASSERT_FALSE(client.request(wish_t::GET, amount_t::ALL, TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, 127, 0, 0, collect));
+    ASSERT_FALSE(client.request(wish_t::SET, amount_t::ALL, TEST_BLOCK_ID, TEST_SECTION_MULTIPLE_PARTS_ID, 0, 0, 0, collect));
+    ASSERT_FALSE(client.special(specialRequest_t::DUMP, collect));
+    ASSERT_FALSE(client.special(specialRequest_t::WINDOW, 2, collect));
+    ASSERT_FALSE(client.custom(CUSTOM_REQUEST_ID_MIN - 1, collect));
+    ASSERT_TRUE(transport.requests.empty());
+}
+
+#ifdef __cpp_impl_coroutine
+TEST_F(SysExTest, Async)
+{
+    // storage completing operations only once the test allows it
+    class AsyncStorage : public AsyncDataHandler
+    {
+        public:
+        Task<uint8_t> get([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t index, uint16_t& value) override
+        {
+            AsyncResult result;
+            pending.push_back(&result);
+
+            auto status = co_await result;
+            value       = TEST_VALUE_GET;
+
+            co_return status;
+        }
+
+        Task<uint8_t> set([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t index, [[maybe_unused]] uint16_t newValue) override
+        {
+            AsyncResult result;
+            pending.push_back(&result);
+            setCalls++;
+
+            co_return co_await result;
+        }
+
+        Task<uint8_t> getRange([[maybe_unused]] uint8_t block, [[maybe_unused]] uint8_t section, [[maybe_unused]] uint16_t startIndex, uint16_t count, uint16_t* values) override
+        {
+            AsyncResult result;
+            pending.push_back(&result);
+            getRangeCalls++;
+
+            auto status = co_await result;
+            std::fill(values, values + count, TEST_VALUE_GET);
+
+            co_return status;
+        }
+
+        uint8_t customRequest([[maybe_unused]] uint16_t request, [[maybe_unused]] DataHandler::CustomResponse& customResponse) override
+        {
+            return static_cast<uint8_t>(status_t::ERROR_NOT_SUPPORTED);
+        }
+
+        void sendResponse(uint8_t* array, uint16_t size) override
+        {
+            responses.emplace_back(array, array + size);
+        }
+
+        void complete(uint8_t status = static_cast<uint8_t>(status_t::ACK))
+        {
+            auto operations = std::move(pending);
+            pending.clear();
+
+            for (auto operation : operations)
+            {
+                operation->complete(status);
+            }
+        }
+
+        std::vector<AsyncResult*>         pending       = {};
+        std::vector<std::vector<uint8_t>> responses     = {};
+        size_t                            setCalls      = 0;
+        size_t                            getRangeCalls = 0;
+    };
+
+    AsyncStorage   storage;
+    SysExConfAsync sysExAsync(storage, M_ID);
+
+    ASSERT_TRUE(sysExAsync.setLayout(sysExLayout));
+
+    // special requests don't need the storage
+    auto connOpen = sysExAsync.handleMessage(&CONN_OPEN[0], CONN_OPEN.size());
+    connOpen.start();
+    ASSERT_TRUE(connOpen.done());
+    ASSERT_TRUE(sysExAsync.isConfigurationEnabled());
+    ASSERT_EQ(1, storage.responses.size());
+    storage.responses.clear();
+
+    // reference responses
+    openConn();
+    handleMessage(GET_ALL_VALID_ALL_PARTS_7_E);
+
+    std::vector<std::vector<uint8_t>> reference;
+
+    for (size_t i = 0; i < dataHandler.responseCounter(); i++)
+    {
+        reference.push_back(dataHandler.response(i));
+    }
+
+    // request is suspended while each part is retrieved
+    auto getAll = sysExAsync.handleMessage(&GET_ALL_VALID_ALL_PARTS_7_E[0], GET_ALL_VALID_ALL_PARTS_7_E.size());
+    getAll.start();
+    ASSERT_FALSE(getAll.done());
+    ASSERT_TRUE(sysExAsync.busy());
+    ASSERT_EQ(1, storage.pending.size());
+    ASSERT_EQ(1, storage.getRangeCalls);
+
+    // next part is retrieved only once the previous one is sent
+    storage.complete();
+    ASSERT_FALSE(getAll.done());
+    ASSERT_EQ(1, storage.pending.size());
+    ASSERT_EQ(1, storage.responses.size());
+
+    storage.complete();
+    ASSERT_TRUE(getAll.done());
+    ASSERT_FALSE(sysExAsync.busy());
+    ASSERT_EQ(reference, storage.responses);
+    storage.responses.clear();
+
+    // requests received meanwhile are processed in order, set is acknowledged once stored
+    auto get = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    auto set = sysExAsync.handleMessage(&SET_SINGLE_VALID[0], SET_SINGLE_VALID.size());
+    get.start();
+    set.start();
+    ASSERT_EQ(1, storage.pending.size());
+    ASSERT_EQ(0, storage.setCalls);
+
+    storage.complete();
+    ASSERT_TRUE(get.done());
+    ASSERT_FALSE(set.done());
+    ASSERT_EQ(1, storage.responses.size());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ACK), storage.responses.at(0).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+    ASSERT_EQ(1, storage.setCalls);
+
+    storage.complete(static_cast<uint8_t>(status_t::ERROR_WRITE));
+    ASSERT_TRUE(set.done());
+    ASSERT_EQ(2, storage.responses.size());
+    ASSERT_EQ(SET_SINGLE_VALID.size(), storage.responses.at(1).size());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ERROR_WRITE), storage.responses.at(1).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+
+    // failed read
+    storage.responses.clear();
+
+    auto getError = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    getError.start();
+    storage.complete(static_cast<uint8_t>(status_t::ERROR_READ));
+    ASSERT_TRUE(getError.done());
+    ASSERT_EQ(1, storage.responses.size());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ERROR_READ), storage.responses.at(0).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+
+    // request destroyed while waiting for its turn gives it up
+    storage.responses.clear();
+
+    auto getWaiting = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    getWaiting.start();
+
+    {
+        auto getDestroyed = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+        getDestroyed.start();
+        ASSERT_FALSE(getDestroyed.done());
+    }
+
+    storage.complete();
+    ASSERT_TRUE(getWaiting.done());
+    ASSERT_FALSE(sysExAsync.busy());
+    ASSERT_TRUE(storage.pending.empty());
+    ASSERT_EQ(1, storage.responses.size());
+
+    // cached and deferred values aren't retrieved
+    storage.responses.clear();
+    ASSERT_TRUE(sysExAsync.setCache(true));
+
+    auto getUncached = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    getUncached.start();
+    storage.complete();
+    ASSERT_TRUE(getUncached.done());
+
+    auto getCached = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    getCached.start();
+    ASSERT_TRUE(getCached.done());
+    ASSERT_EQ(2, storage.responses.size());
+    ASSERT_EQ(storage.responses.at(0), storage.responses.at(1));
+
+    ASSERT_TRUE(sysExAsync.setCache(false));
+    ASSERT_TRUE(sysExAsync.setWriteBehind(true));
+    storage.responses.clear();
+    storage.setCalls = 0;
+
+    auto setDeferred = sysExAsync.handleMessage(&SET_SINGLE_VALID[0], SET_SINGLE_VALID.size());
+    setDeferred.start();
+    ASSERT_TRUE(setDeferred.done());
+    ASSERT_EQ(0, storage.setCalls);
+
+    auto getDeferred = sysExAsync.handleMessage(&GET_SINGLE_VALID[0], GET_SINGLE_VALID.size());
+    getDeferred.start();
+    ASSERT_TRUE(getDeferred.done());
+    ASSERT_EQ(2, storage.responses.size());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ACK), storage.responses.at(1).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+
+    // connection close is acknowledged once deferred values are stored
+    storage.responses.clear();
+
+    auto connClose = sysExAsync.handleMessage(&CONN_CLOSE[0], CONN_CLOSE.size());
+    connClose.start();
+    ASSERT_FALSE(connClose.done());
+    ASSERT_EQ(1, storage.setCalls);
+    ASSERT_TRUE(storage.responses.empty());
+
+    storage.complete(static_cast<uint8_t>(status_t::ERROR_WRITE));
+    ASSERT_TRUE(connClose.done());
+    ASSERT_EQ(1, storage.responses.size());
+    ASSERT_EQ(static_cast<uint8_t>(status_t::ERROR_WRITE), storage.responses.at(0).at(static_cast<uint8_t>(byteOrder_t::STATUS_BYTE)));
+}
+#endif